@@ -0,0 +1,292 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "BatchedLLM.h"
+
+#include <algorithm>
+
+#include "common.h"
+#include "LLMModelRegistry.h"
+
+bool BatchedLLM::Initialize(const std::string &modelPath, const int maxSequences, const int contextSizePerSequence, const int ngl)
+{
+    this->contextSizePerSequence = contextSizePerSequence;
+
+    auto modelParameters = llama_model_default_params();
+    modelParameters.n_gpu_layers = ngl;
+
+    // Share the model with anyone else that has already loaded it
+    model = LLMModelRegistry::Get()->AcquireModel(modelPath, modelParameters);
+
+    if (model == nullptr)
+    {
+        return false;
+    }
+
+    vocab = llama_model_get_vocab(model.get());
+
+    // Each sequence gets its own slice of the context
+    auto contextParameters = llama_context_default_params();
+    contextParameters.n_ctx = maxSequences * contextSizePerSequence;
+    contextParameters.n_batch = contextParameters.n_ctx; // a step can hold the prompts of all sequences
+    contextParameters.n_seq_max = maxSequences;
+    contextParameters.no_perf = false;
+
+    ctx = LLMModelRegistry::Get()->AcquireContext(model, contextParameters);
+
+    if (ctx == nullptr)
+    {
+        return false;
+    }
+
+    llama_batch_free(batch);
+    batch = llama_batch_init(static_cast<int32_t>(contextParameters.n_batch), 0, 1);
+
+    // Set up the sequence slots, each with its own sampler so they don't share token history
+    for (auto &sequence : sequences)
+    {
+        llama_sampler_free(sequence.sampler);
+    }
+
+    sequences.clear();
+    sequences.resize(maxSequences);
+
+    for (int i = 0; i < maxSequences; i++)
+    {
+        auto samplerParameters = llama_sampler_chain_default_params();
+        samplerParameters.no_perf = false;
+
+        sequences[i].seqId = i;
+        sequences[i].sampler = llama_sampler_chain_init(samplerParameters);
+        llama_sampler_chain_add(sequences[i].sampler, llama_sampler_init_greedy());
+    }
+
+    return true;
+}
+
+int BatchedLLM::Submit(const std::string &prompt, const int n_predict, TokenCallback onToken, CompleteCallback onComplete)
+{
+    const auto freeSequence = std::find_if(sequences.begin(), sequences.end(), [](const Sequence &sequence)
+    {
+        return !sequence.active;
+    });
+
+    if (freeSequence == sequences.end())
+    {
+        return -1;
+    }
+
+    auto promptTokens = common_tokenize(vocab, prompt, true, true);
+
+    // The prompt and at least one prediction has to fit in the sequence
+    if (promptTokens.empty() || static_cast<int>(promptTokens.size()) >= contextSizePerSequence)
+    {
+        fprintf(stderr, "%s: prompt of %zu tokens does not fit in a sequence of %d tokens\n", __func__,
+                promptTokens.size(), contextSizePerSequence);
+        return -1;
+    }
+
+    auto &sequence = *freeSequence;
+    sequence.requestId = nextRequestId++;
+    sequence.active = true;
+    sequence.pendingPrompt = std::move(promptTokens);
+    sequence.nextToken = LLAMA_TOKEN_NULL;
+    sequence.nPast = 0;
+    sequence.nPredicted = 0;
+    sequence.nPredict = n_predict;
+    sequence.batchIndex = -1;
+    sequence.response.clear();
+    sequence.onToken = std::move(onToken);
+    sequence.onComplete = std::move(onComplete);
+
+    llama_sampler_reset(sequence.sampler);
+
+    return sequence.requestId;
+}
+
+int BatchedLLM::Step()
+{
+    common_batch_clear(batch);
+
+    // Pack every active sequence into the one batch
+    for (auto &sequence : sequences)
+    {
+        if (!sequence.active) continue;
+
+        if (!sequence.pendingPrompt.empty())
+        {
+            // Newly submitted: evaluate the whole prompt, we only need logits for the last token
+            const auto promptSize = static_cast<int>(sequence.pendingPrompt.size());
+            for (int i = 0; i < promptSize; i++)
+            {
+                common_batch_add(batch, sequence.pendingPrompt[i], sequence.nPast + i, { sequence.seqId }, i == promptSize - 1);
+            }
+
+            sequence.nPast += promptSize;
+            sequence.pendingPrompt.clear();
+        }
+        else
+        {
+            // Already generating: evaluate the token we sampled last step
+            common_batch_add(batch, sequence.nextToken, sequence.nPast, { sequence.seqId }, true);
+            sequence.nPast += 1;
+        }
+
+        sequence.batchIndex = batch.n_tokens - 1;
+    }
+
+    if (batch.n_tokens == 0)
+    {
+        return 0;
+    }
+
+    if (llama_decode(ctx.get(), batch))
+    {
+        fprintf(stderr, "%s : failed to eval, return code %d\n", __func__, 1);
+
+        // We can't tell which sequence caused the problem, so stop them all
+        std::vector<Completion> completions;
+        for (auto &sequence : sequences)
+        {
+            if (sequence.active) completions.push_back(Finish(sequence));
+        }
+
+        for (const auto &completion : completions)
+        {
+            Complete(completion);
+        }
+
+        return 0;
+    }
+
+    // Completions are only reported once every sequence has been sampled, so that a callback that submits a new
+    // request doesn't have it sampled from this batch's logits
+    std::vector<Completion> completions;
+
+    // Sample the next token of each sequence from its own logits
+    for (auto &sequence : sequences)
+    {
+        // A request submitted (e.g. by a token callback) during this loop isn't in the batch
+        if (!sequence.active || sequence.batchIndex < 0) continue;
+
+        const auto newTokenId = llama_sampler_sample(sequence.sampler, ctx.get(), sequence.batchIndex);
+        sequence.batchIndex = -1;
+
+        // is it an end of generation?
+        if (llama_vocab_is_eog(vocab, newTokenId))
+        {
+            completions.push_back(Finish(sequence));
+            continue;
+        }
+
+        const auto text = TokenToPiece(newTokenId);
+
+        sequence.response += text;
+        sequence.nPredicted++;
+        sequence.nextToken = newTokenId;
+
+        if (sequence.onToken)
+        {
+            sequence.onToken(sequence.requestId, text);
+        }
+
+        // Stop when we've predicted enough or the sequence is out of room
+        if (sequence.nPredicted >= sequence.nPredict || sequence.nPast >= contextSizePerSequence)
+        {
+            completions.push_back(Finish(sequence));
+        }
+    }
+
+    for (const auto &completion : completions)
+    {
+        Complete(completion);
+    }
+
+    return batch.n_tokens;
+}
+
+void BatchedLLM::RunToCompletion()
+{
+    while (CountActiveSequences() > 0)
+    {
+        Step();
+    }
+}
+
+void BatchedLLM::Cancel(const int requestId)
+{
+    for (auto &sequence : sequences)
+    {
+        if (sequence.active && sequence.requestId == requestId)
+        {
+            Complete(Finish(sequence));
+        }
+    }
+}
+
+BatchedLLM::Completion BatchedLLM::Finish(Sequence &sequence)
+{
+    // Free the sequence's slice of the KV cache straight away so that it can be used by the next request
+    llama_memory_seq_rm(llama_get_memory(ctx.get()), sequence.seqId, -1, -1);
+
+    sequence.active = false;
+    sequence.pendingPrompt.clear();
+    sequence.batchIndex = -1;
+
+    // Taken out of the sequence, as the callback may submit a new request into it
+    return { sequence.requestId, std::move(sequence.response), std::move(sequence.onComplete) };
+}
+
+void BatchedLLM::Complete(const Completion &completion)
+{
+    if (completion.onComplete)
+    {
+        completion.onComplete(completion.requestId, completion.response);
+    }
+}
+
+std::string BatchedLLM::TokenToPiece(const llama_token token) const
+{
+    char buf[128];
+    const int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+    if (n < 0)
+    {
+        fprintf(stderr, "%s: error: failed to convert token to piece\n", __func__);
+        return {};
+    }
+    return {buf, static_cast<size_t>(n)};
+}
+
+bool BatchedLLM::HasFreeSequence() const
+{
+    return CountActiveSequences() < GetMaxSequences();
+}
+
+int BatchedLLM::CountActiveSequences() const
+{
+    return static_cast<int>(std::count_if(sequences.begin(), sequences.end(), [](const Sequence &sequence)
+    {
+        return sequence.active;
+    }));
+}
+
+int BatchedLLM::GetMaxSequences() const
+{
+    return static_cast<int>(sequences.size());
+}
+
+int BatchedLLM::GetContextSizePerSequence() const
+{
+    return contextSizePerSequence;
+}
+
+BatchedLLM::~BatchedLLM()
+{
+    llama_batch_free(batch);
+
+    for (const auto &sequence : sequences)
+    {
+        llama_sampler_free(sequence.sampler);
+    }
+}
@@ -0,0 +1,107 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_BATCHEDLLM_H
+#define GAME3_BATCHEDLLM_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llama.h"
+
+/**
+ * Generates text for many prompts at once (e.g. one per NPC) by packing all of them into a single llama_batch,
+ * each with its own llama_seq_id. Every call to Step() decodes one token for every active sequence (or the whole
+ * prompt of a newly submitted one) in a single llama_decode, so throughput scales with the number of sequences
+ * rather than serialising them.
+ */
+class BatchedLLM
+{
+public:
+    // Called with each predicted token of a request, as soon as it is sampled
+    using TokenCallback = std::function<void(int requestId, const std::string &token)>;
+
+    // Called once the request has finished, with the full response
+    using CompleteCallback = std::function<void(int requestId, const std::string &response)>;
+
+    BatchedLLM() = default;
+    BatchedLLM(const BatchedLLM &) = delete;
+    BatchedLLM &operator=(const BatchedLLM &) = delete;
+    ~BatchedLLM();
+
+    /**
+     * @param modelPath path to the model gguf file
+     * @param maxSequences number of sequences that can be generated at the same time
+     * @param contextSizePerSequence number of tokens (prompt and prediction) each sequence can hold
+     * @param ngl number of layers to offload to the GPU
+     * @return true if the model and context are ready to use
+     */
+    bool Initialize(const std::string &modelPath, int maxSequences = 8, int contextSizePerSequence = 512, int ngl = 99);
+
+    /**
+     * Puts the prompt into a free sequence, it will be decoded along with the other active sequences on the next Step().
+     * @return the request id or -1 if there is no free sequence or the prompt does not fit in one
+     */
+    int Submit(const std::string &prompt, int n_predict, TokenCallback onToken = {}, CompleteCallback onComplete = {});
+
+    /**
+     * Decodes all active sequences together and samples the next token of each.
+     * @return the number of tokens that were decoded
+     */
+    int Step();
+
+    // Steps until there are no more active sequences
+    void RunToCompletion();
+
+    // Stops the request and frees its sequence (its complete callback is still called)
+    void Cancel(int requestId);
+
+    [[nodiscard]] bool HasFreeSequence() const;
+    [[nodiscard]] int CountActiveSequences() const;
+    [[nodiscard]] int GetMaxSequences() const;
+    [[nodiscard]] int GetContextSizePerSequence() const;
+
+private:
+    struct Sequence
+    {
+        llama_seq_id seqId = 0;
+        int requestId = -1;
+        bool active = false;
+        std::vector<llama_token> pendingPrompt; // prompt tokens still to be decoded
+        llama_token nextToken = LLAMA_TOKEN_NULL; // last sampled token, decoded on the next step
+        llama_pos nPast = 0; // number of tokens of this sequence in the KV cache
+        int nPredicted = 0;
+        int nPredict = 0;
+        int32_t batchIndex = -1; // where this sequence's logits are in the current batch
+        llama_sampler *sampler = nullptr;
+        std::string response;
+        TokenCallback onToken;
+        CompleteCallback onComplete;
+    };
+
+    // What a finished request's complete callback is called with
+    struct Completion
+    {
+        int requestId = -1;
+        std::string response;
+        CompleteCallback onComplete;
+    };
+
+    // Frees the sequence for the next request, the caller calls the complete callback once it is safe to Submit again
+    [[nodiscard]] Completion Finish(Sequence &sequence);
+    static void Complete(const Completion &completion);
+    [[nodiscard]] std::string TokenToPiece(llama_token token) const;
+
+    std::shared_ptr<llama_model> model;
+    std::shared_ptr<llama_context> ctx;
+    const llama_vocab *vocab {};
+    llama_batch batch {};
+    std::vector<Sequence> sequences;
+    int contextSizePerSequence = 0;
+    int nextRequestId = 0;
+};
+
+#endif //GAME3_BATCHEDLLM_H
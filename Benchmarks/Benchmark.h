@@ -0,0 +1,64 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_BENCHMARK_H
+#define GAME3_BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One line of benchmark output: what was measured and the numbers that came out of it
+struct BenchmarkResult
+{
+    std::string name;
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+// Runs the function the given number of times and returns the average time of one run in microseconds
+template<typename Function>
+double TimeMicroseconds(Function function, const int iterations = 1)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        function();
+    }
+    const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / iterations;
+}
+
+std::vector<BenchmarkResult> RunEmbeddingSearchBenchmarks(int count, int n_embd);
+
+// How long wandering NPCs take to decide which way to go next
+std::vector<BenchmarkResult> RunNpcBenchmarks(int npcCount);
+
+struct LLMBenchmarkOptions
+{
+    std::string settingsFilePath = "data/settings.xml"; // where the model paths come from
+    std::vector<int> promptLengths = {32, 128, 512}; // in words, roughly a token each
+    std::vector<int> threadCounts = {0}; // 0 uses the "inferenceThreading" settings
+    int n_predict = 64;
+    int runs = 3; // each result is the average of this many
+    int maxEmbeddingWords = 256; // longer prompts are skipped for the embedding model
+};
+
+// Model load time, prompt and generation tokens/s, time to first token and peak RSS for each LLM
+std::vector<BenchmarkResult> RunLLMBenchmarks(const LLMBenchmarkOptions &options);
+
+// One result per line, so that a file can be compared with a later one (see ReadBenchmarkJson)
+bool WriteBenchmarkJson(const std::string &path, const std::vector<BenchmarkResult> &results);
+std::vector<BenchmarkResult> ReadBenchmarkJson(const std::string &path);
+
+/**
+ * Compares the results against a baseline, only metrics whose name says which way is better are compared:
+ * ..._per_s and recall... should go up, ..._ms, ..._mb, us_per_... and ns_per_... should go down.
+ * @param tolerance how much worse (as a fraction) a metric can get before it counts as a regression
+ * @return a line describing each regression
+ */
+std::vector<std::string> FindRegressions(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &results,
+                                         double tolerance);
+
+#endif //GAME3_BENCHMARK_H
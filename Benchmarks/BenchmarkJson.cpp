@@ -0,0 +1,134 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <string>
+
+#include "Benchmark.h"
+
+namespace
+{
+    bool EndsWith(const std::string &text, const std::string &suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool StartsWith(const std::string &text, const std::string &prefix)
+    {
+        return text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    // 1 if bigger is better, -1 if smaller is better, 0 if the metric is just for information (e.g. a count)
+    int BetterDirection(const std::string &metric)
+    {
+        if (EndsWith(metric, "_per_s") || StartsWith(metric, "recall")) return 1;
+        if (EndsWith(metric, "_ms") || EndsWith(metric, "_mb") || StartsWith(metric, "us_per_") || StartsWith(metric, "ns_per_")) return -1;
+        return 0;
+    }
+}
+
+bool WriteBenchmarkJson(const std::string &path, const std::vector<BenchmarkResult> &results)
+{
+    FILE* file = fopen(path.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        fprintf(stderr, "%s: error: unable to create %s\n", __func__, path.c_str());
+        return false;
+    }
+
+    fprintf(file, "{\"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        fprintf(file, "  {\"name\": \"%s\", \"metrics\": {", results[i].name.c_str());
+        for (size_t m = 0; m < results[i].metrics.size(); m++)
+        {
+            const auto &[metric, value] = results[i].metrics[m];
+            fprintf(file, "%s\"%s\": %.6g", m > 0 ? ", " : "", metric.c_str(), std::isfinite(value) ? value : 0.0);
+        }
+        fprintf(file, "}}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "]}\n");
+
+    return fclose(file) == 0;
+}
+
+std::vector<BenchmarkResult> ReadBenchmarkJson(const std::string &path)
+{
+    std::vector<BenchmarkResult> results;
+    std::ifstream file(path);
+
+    // Only has to read what WriteBenchmarkJson writes, a result per line
+    const std::regex name(R"re("name":\s*"([^"]*)")re");
+    const std::regex metric(R"re("([^"]+)":\s*(-?[0-9.]+(?:[eE][-+]?[0-9]+)?))re");
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // Skip anything that isn't a result, e.g. a baseline edited by hand
+        std::smatch match;
+        const auto metricsStart = line.find("\"metrics\"");
+        if (metricsStart == std::string::npos || !std::regex_search(line, match, name))
+        {
+            continue;
+        }
+
+        BenchmarkResult result {match[1].str(), {}};
+
+        const auto metrics = line.substr(metricsStart);
+        for (auto it = std::sregex_iterator(metrics.begin(), metrics.end(), metric); it != std::sregex_iterator(); ++it)
+        {
+            result.metrics.emplace_back((*it)[1].str(), std::stod((*it)[2].str()));
+        }
+
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+std::vector<std::string> FindRegressions(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &results,
+                                         const double tolerance)
+{
+    std::vector<std::string> regressions;
+
+    for (const auto &result : results)
+    {
+        const auto before = std::find_if(baseline.begin(), baseline.end(), [&](const BenchmarkResult &b) { return b.name == result.name; });
+
+        // A new benchmark has nothing to be compared with
+        if (before == baseline.end())
+        {
+            continue;
+        }
+
+        for (const auto &[metric, value] : result.metrics)
+        {
+            const auto direction = BetterDirection(metric);
+            const auto previous = std::find_if(before->metrics.begin(), before->metrics.end(), [&](const auto &m) { return m.first == metric; });
+
+            if (direction == 0 || previous == before->metrics.end() || previous->second == 0)
+            {
+                continue;
+            }
+
+            // How much worse it got, as a fraction of the baseline
+            const auto worse = direction * (previous->second - value) / std::abs(previous->second);
+
+            if (worse > tolerance)
+            {
+                char line[256];
+                snprintf(line, sizeof(line), "%s %s: %.3f -> %.3f (%.1f%% worse)", result.name.c_str(), metric.c_str(),
+                         previous->second, value, worse * 100.0);
+                regressions.emplace_back(line);
+            }
+        }
+    }
+
+    return regressions;
+}
@@ -0,0 +1,112 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "Benchmark.h"
+
+namespace
+{
+    std::vector<int> ParseList(const char* text)
+    {
+        std::vector<int> values;
+        std::stringstream list(text);
+        std::string value;
+        while (std::getline(list, value, ','))
+        {
+            values.push_back(std::atoi(value.c_str()));
+        }
+        return values;
+    }
+
+    void Print(const std::vector<BenchmarkResult> &results)
+    {
+        for (const auto &result : results)
+        {
+            printf("%-40s", result.name.c_str());
+            for (const auto &[metric, value] : result.metrics)
+            {
+                printf(" %s=%.3f", metric.c_str(), value);
+            }
+            printf("\n");
+        }
+    }
+}
+
+// Usage: game3_bench [number of vectors] [dimensions] [--llm] [--settings file] [--prompts 32,128,512]
+//                    [--threads 2,4,8] [--predict n] [--runs n] [--npcs n] [--json file] [--baseline file]
+//                    [--tolerance 0.1]
+//
+// --llm also benchmarks the LLMs with the models in the settings file. --json writes the results for a later run's
+// --baseline, which makes the exit code 1 if any result has got worse by more than the tolerance.
+int main(const int argc, char* argv[])
+{
+    int count = 20000;
+    int n_embd = 384;
+    int npcCount = 500;
+    bool benchmarkLLMs = false;
+    LLMBenchmarkOptions llmOptions;
+    std::string jsonPath;
+    std::string baselinePath;
+    double tolerance = 0.1;
+
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--llm") == 0) benchmarkLLMs = true;
+        else if (std::strcmp(argv[i], "--settings") == 0 && hasValue) llmOptions.settingsFilePath = argv[++i];
+        else if (std::strcmp(argv[i], "--prompts") == 0 && hasValue) llmOptions.promptLengths = ParseList(argv[++i]);
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) llmOptions.threadCounts = ParseList(argv[++i]);
+        else if (std::strcmp(argv[i], "--predict") == 0 && hasValue) llmOptions.n_predict = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--runs") == 0 && hasValue) llmOptions.runs = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--npcs") == 0 && hasValue) npcCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--json") == 0 && hasValue) jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) baselinePath = argv[++i];
+        else if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue) tolerance = std::atof(argv[++i]);
+        else if (positional == 0) { count = std::atoi(argv[i]); positional++; }
+        else if (positional == 1) { n_embd = std::atoi(argv[i]); positional++; }
+        else
+        {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    auto results = RunEmbeddingSearchBenchmarks(count, n_embd);
+
+    const auto npcResults = RunNpcBenchmarks(npcCount);
+    results.insert(results.end(), npcResults.begin(), npcResults.end());
+    Print(results);
+
+    if (benchmarkLLMs)
+    {
+        const auto llmResults = RunLLMBenchmarks(llmOptions);
+        Print(llmResults);
+        results.insert(results.end(), llmResults.begin(), llmResults.end());
+    }
+
+    if (!jsonPath.empty() && !WriteBenchmarkJson(jsonPath, results))
+    {
+        return 2;
+    }
+
+    if (!baselinePath.empty())
+    {
+        const auto regressions = FindRegressions(ReadBenchmarkJson(baselinePath), results, tolerance);
+
+        for (const auto &regression : regressions)
+        {
+            printf("REGRESSION %s\n", regression.c_str());
+        }
+
+        return regressions.empty() ? 0 : 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+#include "Benchmark.h"
+#include "EmbeddingIndex.h"
+#include "HnswIndex.h"
+#include "VectorKernels.h"
+
+namespace
+{
+    constexpr int queryCount = 200;
+    constexpr int k = 10;
+
+    // Unit length vectors scattered around topics. Real embeddings cluster like this, uniformly random ones would
+    // make any approximate index look much worse than it is in practice.
+    std::vector<float> TopicEmbeddings(const int count, const int n_embd, const unsigned seed)
+    {
+        constexpr int topics = 100;
+        std::mt19937 random(seed);
+        std::normal_distribution<float> distribution;
+
+        std::mt19937 topicRandom(0); // the same topics for the stored vectors and the queries
+        std::vector<float> centres(static_cast<size_t>(topics) * n_embd);
+        for (auto &value : centres)
+        {
+            value = distribution(topicRandom);
+        }
+
+        std::vector<float> embeddings(static_cast<size_t>(count) * n_embd);
+        for (int i = 0; i < count; i++)
+        {
+            const float* centre = centres.data() + static_cast<size_t>(random() % topics) * n_embd;
+            float* row = embeddings.data() + static_cast<size_t>(i) * n_embd;
+            float norm = 0;
+            for (int j = 0; j < n_embd; j++)
+            {
+                row[j] = centre[j] + 0.5f * distribution(random);
+                norm += row[j] * row[j];
+            }
+            norm = std::sqrt(norm);
+            for (int j = 0; j < n_embd; j++)
+            {
+                row[j] /= norm;
+            }
+        }
+
+        return embeddings;
+    }
+
+    // Fraction of the exact top k that were also found
+    double Recall(const std::vector<std::vector<EmbeddingMatch>> &exact, const std::vector<std::vector<EmbeddingMatch>> &found)
+    {
+        int hits = 0;
+        int total = 0;
+        for (size_t q = 0; q < exact.size(); q++)
+        {
+            for (const auto &match : exact[q])
+            {
+                hits += std::any_of(found[q].begin(), found[q].end(), [&](const EmbeddingMatch &m) { return m.id == match.id; });
+                total++;
+            }
+        }
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+
+    // Percentage of the float32 index's memory that a smaller one saves
+    double MemorySaved(const EmbeddingIndex &exact, const EmbeddingIndex &smaller)
+    {
+        return 100.0 * (1.0 - static_cast<double>(smaller.GetMemoryUsage()) / static_cast<double>(exact.GetMemoryUsage()));
+    }
+
+    // Runs every query and measures the average time per query
+    template<typename Index>
+    std::vector<std::vector<EmbeddingMatch>> RunQueries(const Index &index, const std::vector<float> &queries, const int n_embd, double &microsecondsPerQuery)
+    {
+        std::vector<std::vector<EmbeddingMatch>> results(queryCount);
+        microsecondsPerQuery = TimeMicroseconds([&]()
+        {
+            for (int q = 0; q < queryCount; q++)
+            {
+                results[q] = index.Search(queries.data() + static_cast<size_t>(q) * n_embd, k);
+            }
+        }) / queryCount;
+        return results;
+    }
+}
+
+std::vector<BenchmarkResult> RunEmbeddingSearchBenchmarks(const int count, const int n_embd)
+{
+    std::vector<BenchmarkResult> results;
+
+    const auto embeddings = TopicEmbeddings(count, n_embd, 1);
+    const auto queries = TopicEmbeddings(queryCount, n_embd, 2);
+    const std::string size = std::to_string(count) + "x" + std::to_string(n_embd);
+
+    // Exact search is the baseline for recall
+    EmbeddingIndex exact(n_embd);
+    exact.AddAll(embeddings.data(), count);
+
+    double microseconds = 0;
+    const auto expected = RunQueries(exact, queries, n_embd, microseconds);
+    results.push_back({"exact_float32/" + size + "/" + GetVectorKernelName(), {
+        {"us_per_query", microseconds},
+        {"recall_at_10", 1.0},
+        {"memory_mb", exact.GetMemoryUsage() / (1024.0 * 1024.0)}}});
+
+    EmbeddingIndex quantised(n_embd, EmbeddingStorage::Int8);
+    quantised.AddAll(embeddings.data(), count);
+
+    const auto quantisedResults = RunQueries(quantised, queries, n_embd, microseconds);
+    results.push_back({"exact_int8/" + size + "/" + GetVectorKernelName(), {
+        {"us_per_query", microseconds},
+        {"recall_at_10", Recall(expected, quantisedResults)},
+        {"memory_mb", quantised.GetMemoryUsage() / (1024.0 * 1024.0)},
+        {"memory_saved_pct", MemorySaved(exact, quantised)}}});
+
+    EmbeddingIndex binary(n_embd, EmbeddingStorage::Binary);
+    binary.AddAll(embeddings.data(), count);
+
+    const auto binaryResults = RunQueries(binary, queries, n_embd, microseconds);
+    results.push_back({"exact_binary/" + size + "/" + GetVectorKernelName(), {
+        {"us_per_query", microseconds},
+        {"recall_at_10", Recall(expected, binaryResults)},
+        {"memory_mb", binary.GetMemoryUsage() / (1024.0 * 1024.0)},
+        {"memory_saved_pct", MemorySaved(exact, binary)}}});
+
+    // The quantised scan picks the candidates, the float32 vectors (which needn't be held by the index) order them
+    for (const auto *index : { &quantised, &binary })
+    {
+        for (const int candidates : { 2 * k, 10 * k, 50 * k })
+        {
+            std::vector<std::vector<EmbeddingMatch>> reranked(queryCount);
+            microseconds = TimeMicroseconds([&]()
+            {
+                for (int q = 0; q < queryCount; q++)
+                {
+                    reranked[q] = index->SearchAndRerank(queries.data() + static_cast<size_t>(q) * n_embd, k, candidates, embeddings.data());
+                }
+            }) / queryCount;
+
+            const std::string storage = index->GetStorage() == EmbeddingStorage::Int8 ? "int8" : "binary";
+            results.push_back({"rerank_" + storage + "_c" + std::to_string(candidates) + "/" + size + "/" + GetVectorKernelName(), {
+                {"us_per_query", microseconds},
+                {"recall_at_10", Recall(expected, reranked)},
+                {"memory_mb", index->GetMemoryUsage() / (1024.0 * 1024.0)},
+                {"memory_saved_pct", MemorySaved(exact, *index)}}});
+        }
+    }
+
+    // The graph is built once, then searched with increasingly wide beams
+    HnswIndex hnsw(n_embd);
+    const double buildMicroseconds = TimeMicroseconds([&]()
+    {
+        hnsw.AddAll(embeddings.data(), count);
+    });
+
+    for (const int efSearch : { 16, 32, 64, 128, 256 })
+    {
+        hnsw.SetEfSearch(efSearch);
+        const auto approximate = RunQueries(hnsw, queries, n_embd, microseconds);
+        results.push_back({"hnsw_ef" + std::to_string(efSearch) + "/" + size, {
+            {"us_per_query", microseconds},
+            {"recall_at_10", Recall(expected, approximate)},
+            {"build_ms", buildMicroseconds / 1000.0}}});
+    }
+
+    return results;
+}
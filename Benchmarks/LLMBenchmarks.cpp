@@ -0,0 +1,259 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <file/SettingsManager.h>
+#include <events/EventManager.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define NULL_DEVICE "NUL"
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#include "Benchmark.h"
+#include "EmbeddingLLM.h"
+#include "InferenceThreading.h"
+#include "LLMModelRegistry.h"
+#include "SimpleLLM.h"
+#include "StreamingLLM.h"
+
+namespace
+{
+    constexpr int embeddingTextsPerRun = 32;
+
+    // Largest the process has been so far, so it only ever goes up from one benchmark to the next
+    double PeakResidentSetMegabytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters {};
+        GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+        return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+    }
+
+    // The LLMs echo prompts and answers and llama.cpp logs a lot, none of which belongs in the benchmark output
+    template<typename Function>
+    void Quietly(Function function)
+    {
+        fflush(stdout);
+        const int oldStdOut = dup(fileno(stdout));
+        FILE* nullDevice = fopen(NULL_DEVICE, "w");
+        dup2(fileno(nullDevice), fileno(stdout));
+        fclose(nullDevice);
+
+        StreamingLLM::RunWithoutStdErrOutput(function);
+
+        fflush(stdout);
+        dup2(oldStdOut, fileno(stdout));
+        close(oldStdOut);
+    }
+
+    // Roughly one token per word. Each run starts differently so that none of it comes from the prompt cache.
+    std::string MakeText(const int words, const int run)
+    {
+        static const char* vocabulary[] = {
+            "the", "old", "wizard", "walked", "slowly", "through", "a", "dark", "maze", "of", "stone", "rooms",
+            "looking", "for", "gold", "and", "keys", "while", "guards", "slept", "near", "torches", "in", "halls"
+        };
+        constexpr int vocabularySize = sizeof(vocabulary) / sizeof(vocabulary[0]);
+
+        std::string text = "Story " + std::to_string(run) + ":";
+        for (int i = 0; i < words; i++)
+        {
+            text += " ";
+            text += vocabulary[(i * 7 + run * 13) % vocabularySize];
+        }
+        return text + ". What happens next?";
+    }
+
+    std::string ThreadsName(const int threads)
+    {
+        return threads > 0 ? std::to_string(threads) : "settings";
+    }
+
+    // Loads the model from scratch (nothing is left in the registry to share) and returns how long it took
+    template<typename Function>
+    double TimeModelLoad(Function initialize)
+    {
+        LLMModelRegistry::Get()->ReleaseIdleContexts();
+
+        double microseconds = 0;
+        Quietly([&]() { microseconds = TimeMicroseconds(initialize); });
+        return microseconds / 1000.0;
+    }
+
+    // The average of the runs' stats
+    struct AverageStats
+    {
+        InferenceStats total {};
+        int runs = 0;
+
+        void Add(const InferenceStats &stats)
+        {
+            total.promptTokens += stats.promptTokens;
+            total.promptMs += stats.promptMs;
+            total.generatedTokens += stats.generatedTokens;
+            total.generationMs += stats.generationMs;
+            total.firstTokenMs += stats.firstTokenMs;
+            runs++;
+        }
+
+        [[nodiscard]] std::vector<std::pair<std::string, double>> Metrics(const double loadMs) const
+        {
+            const auto n = std::max(1, runs);
+            return {
+                {"load_ms", loadMs},
+                {"prompt_tokens", static_cast<double>(total.promptTokens) / n},
+                {"prompt_tokens_per_s", total.PromptTokensPerSecond()},
+                {"generation_tokens_per_s", total.GenerationTokensPerSecond()},
+                {"first_token_ms", total.firstTokenMs / n},
+                {"peak_rss_mb", PeakResidentSetMegabytes()}};
+        }
+    };
+
+    void BenchmarkSimpleLLM(const LLMBenchmarkOptions &options, const std::string &modelPath, const int threads,
+                            std::vector<BenchmarkResult> &results)
+    {
+        SimpleLLM llm;
+        const auto loadMs = TimeModelLoad([&]() { llm.Initialize(modelPath); });
+
+        for (const auto words : options.promptLengths)
+        {
+            AverageStats stats;
+            for (int run = 0; run < options.runs; run++)
+            {
+                Quietly([&]() { llm.Infer(MakeText(words, run), options.n_predict); });
+                stats.Add(llm.GetLastStats());
+            }
+
+            results.push_back({"SimpleLLM/prompt" + std::to_string(words) + "/threads_" + ThreadsName(threads), stats.Metrics(loadMs)});
+        }
+    }
+
+    void BenchmarkStreamingLLM(const LLMBenchmarkOptions &options, const int threads, std::vector<BenchmarkResult> &results)
+    {
+        // An end of answer marker that never turns up, so every run predicts the same number of tokens
+        StreamingLLM llm("<never>");
+
+        // A restored prompt isn't evaluated, which is no use when timing prompt evaluation
+        llm.SetSessions(false);
+        double loadMs = 0;
+
+        for (const auto words : options.promptLengths)
+        {
+            AverageStats stats;
+            for (int run = 0; run < options.runs; run++)
+            {
+                const auto prompt = MakeText(words, run);
+                const auto initialize = [&]() { llm.Initialize(prompt, options.n_predict); };
+
+                // The first Initialize loads the model
+                if (loadMs == 0)
+                {
+                    loadMs = TimeModelLoad(initialize);
+                }
+                else
+                {
+                    Quietly(initialize);
+                }
+
+                Quietly([&]() { llm.Update(0); });
+
+                // Nobody is listening, this just stops the token events piling up
+                gamelib::EventManager::Get()->ProcessAllEvents();
+
+                stats.Add(llm.GetLastStats());
+            }
+
+            results.push_back({"StreamingLLM/prompt" + std::to_string(words) + "/threads_" + ThreadsName(threads), stats.Metrics(loadMs)});
+        }
+    }
+
+    void BenchmarkEmbeddingLLM(const LLMBenchmarkOptions &options, const std::string &modelPath, const int threads,
+                               std::vector<BenchmarkResult> &results)
+    {
+        EmbeddingLLM llm;
+        const auto loadMs = TimeModelLoad([&]() { llm.Initialize(modelPath); });
+
+        for (const auto words : options.promptLengths)
+        {
+            // Embedding models only take short inputs
+            if (words > options.maxEmbeddingWords)
+            {
+                continue;
+            }
+
+            double microseconds = 0;
+            for (int run = 0; run < options.runs; run++)
+            {
+                // Different texts every run, so none of them come from the cache
+                std::vector<std::string> texts;
+                for (int i = 0; i < embeddingTextsPerRun; i++)
+                {
+                    texts.push_back(MakeText(words, run * embeddingTextsPerRun + i));
+                }
+
+                Quietly([&]() { microseconds += TimeMicroseconds([&]() { llm.GetEmbeddings(texts); }); });
+            }
+
+            const auto texts = static_cast<double>(options.runs) * embeddingTextsPerRun;
+            results.push_back({"EmbeddingLLM/prompt" + std::to_string(words) + "/threads_" + ThreadsName(threads), {
+                {"load_ms", loadMs},
+                {"texts_per_s", microseconds > 0 ? texts * 1000000.0 / microseconds : 0},
+                {"peak_rss_mb", PeakResidentSetMegabytes()}}});
+        }
+    }
+}
+
+std::vector<BenchmarkResult> RunLLMBenchmarks(const LLMBenchmarkOptions &options)
+{
+    std::vector<BenchmarkResult> results;
+
+    if (!gamelib::SettingsManager::Get()->ReadSettingsFile(options.settingsFilePath))
+    {
+        fprintf(stderr, "%s: error: unable to read %s\n", __func__, options.settingsFilePath.c_str());
+        return results;
+    }
+
+    const auto inferringModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+    const auto embeddingModelPath = gamelib::SettingsManager::Get()->GetString("llm", "EmbeddingModelPath");
+
+    for (const auto threads : options.threadCounts)
+    {
+        // 0 keeps whatever the settings say
+        InferenceThreading::Get()->LoadSettings();
+        if (threads > 0)
+        {
+            InferenceThreading::Get()->SetThreads(threads, threads);
+        }
+
+        BenchmarkSimpleLLM(options, inferringModelPath, threads, results);
+        BenchmarkStreamingLLM(options, threads, results);
+        BenchmarkEmbeddingLLM(options, embeddingModelPath, threads, results);
+    }
+
+    LLMModelRegistry::Get()->ReleaseIdleContexts();
+
+    return results;
+}
@@ -0,0 +1,120 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include <random>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "MoveProbabilityMatrix.h"
+#include "JobSystem.h"
+#include "Navigation.h"
+#include "NpcSimulation.h"
+
+namespace
+{
+    constexpr int decisionsPerNpc = 1000;
+
+    // A maze's worth of rooms, each with a random set of walls (at least one way out)
+    std::vector<uint8_t> RandomOpenDirections(const int rooms)
+    {
+        std::mt19937 random(3);
+        std::vector<uint8_t> openDirections(rooms);
+        for (auto &open : openDirections)
+        {
+            open = static_cast<uint8_t>(1 + random() % 15);
+        }
+        return openDirections;
+    }
+}
+
+std::vector<BenchmarkResult> RunNpcBenchmarks(const int npcCount)
+{
+    std::vector<BenchmarkResult> results;
+
+    constexpr int roomCount = 50 * 50;
+    const MoveProbabilityMatrix matrix(RandomOpenDirections(roomCount));
+
+    std::vector<int> rooms(npcCount);
+    std::vector<NpcRandom> randoms;
+    randoms.reserve(npcCount);
+    for (int i = 0; i < npcCount; i++)
+    {
+        rooms[i] = static_cast<int>((static_cast<long long>(i) * 7919) % roomCount);
+        randoms.emplace_back(i, i);
+    }
+
+    std::vector<gamelib::Direction> directions(npcCount);
+
+    const auto oneAtATime = TimeMicroseconds([&]()
+    {
+        for (int i = 0; i < npcCount; i++)
+        {
+            directions[i] = matrix.SelectAction(rooms[i], randoms[i]);
+        }
+    }, decisionsPerNpc);
+
+    const auto batched = TimeMicroseconds([&]()
+    {
+        matrix.SelectActions(rooms.data(), randoms.data(), directions.data(), npcCount);
+    }, decisionsPerNpc);
+
+    const std::string size = std::to_string(npcCount) + "_npcs";
+    results.push_back({"select_action/" + size, {{"ns_per_decision", oneAtATime * 1000.0 / npcCount}}});
+    results.push_back({"select_actions_batch/" + size, {{"ns_per_decision", batched * 1000.0 / npcCount}}});
+
+    // Every NPC heading for the same (moving) room, e.g. chasing the player
+    constexpr int columns = 50;
+    Navigation navigation(RoomGraph(RandomOpenDirections(roomCount), columns));
+    FlowField moving(navigation.GetGraph());
+    int target = 0;
+
+    const auto retarget = TimeMicroseconds([&]()
+    {
+        target = (target + 1) % roomCount;
+        moving.SetTarget(target);
+    }, 100);
+
+    const auto chasing = TimeMicroseconds([&]()
+    {
+        const auto &flowField = navigation.GetFlowField(target);
+        for (int i = 0; i < npcCount; i++)
+        {
+            directions[i] = flowField.GetNextDirection(rooms[i]);
+        }
+    }, decisionsPerNpc);
+
+    results.push_back({"flow_field_search/" + std::to_string(roomCount) + "_rooms", {{"us_per_search", retarget}}});
+    results.push_back({"flow_field_next_direction/" + size, {{"ns_per_decision", chasing * 1000.0 / npcCount}}});
+
+    // A crowd of wandering NPCs updated as one, a 60 Hz frame is 16.7 ms
+    constexpr int crowdSize = 10000;
+    const auto openDirections = RandomOpenDirections(roomCount);
+    NpcSimulation simulation(std::make_shared<MoveProbabilityMatrix>(openDirections),
+                             std::make_shared<Navigation>(RoomGraph(openDirections, columns)), {0, 0, 64, 64, columns});
+    for (int i = 0; i < crowdSize; i++)
+    {
+        simulation.Add(i % roomCount, i);
+    }
+
+    const auto tick = TimeMicroseconds([&]()
+    {
+        simulation.Update(16);
+    }, decisionsPerNpc);
+
+    results.push_back({"npc_simulation_tick/" + std::to_string(crowdSize) + "_npcs", {{"us_per_tick", tick}, {"ns_per_npc", tick * 1000.0 / crowdSize}}});
+
+    // The same crowd shared out across every core, it should get quicker with more of them
+    JobSystem jobs(static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) - 1);
+    const auto threadedTick = TimeMicroseconds([&]()
+    {
+        simulation.Update(16, &jobs);
+    }, decisionsPerNpc);
+
+    results.push_back({"npc_simulation_tick_jobs/" + std::to_string(crowdSize) + "_npcs",
+                       {{"us_per_tick", threadedTick}, {"threads", jobs.GetThreadCount()}}});
+
+    return results;
+}
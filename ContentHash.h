@@ -0,0 +1,22 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_CONTENTHASH_H
+#define GAME3_CONTENTHASH_H
+
+#include <cstdint>
+#include <string_view>
+
+// 64-bit FNV-1a hash of some content, e.g. the text of a prompt. Stable across runs and platforms.
+inline uint64_t ContentHash(const std::string_view content, uint64_t hash = 14695981039346656037ULL)
+{
+    for (const auto c : content)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#endif //GAME3_CONTENTHASH_H
@@ -11,7 +11,7 @@ gamelib::Status DecideNextDirection::Update(const unsigned long deltaMs)
     {
         std::cout << "Deciding.\n";
         // Decide next direction to move in
-        const auto validMoveDirection = npc->GetProbabilityMatrix()->SelectAction(npc->GetCurrentRoom());
+        const auto validMoveDirection = npc->GetProbabilityMatrix()->SelectAction(npc->GetCurrentRoom(), npc->GetRandom());
 
         // Set facing direction to the sampled direction
         npc->SetDirection(validMoveDirection);
@@ -0,0 +1,59 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "EmbeddingBatchPacker.h"
+
+#include <algorithm>
+#include <numeric>
+
+std::vector<std::vector<int>> EmbeddingBatchPacker::Pack(const std::vector<int> &lengths, const int batchSize, const int maxSequences)
+{
+    // Longest first, ties stay in input order so that the same inputs are always packed the same way
+    std::vector<int> order(lengths.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](const int a, const int b) { return lengths[a] > lengths[b]; });
+
+    std::vector<std::vector<int>> batches;
+    std::vector<int> room; // tokens left in each batch
+
+    for (const auto input : order)
+    {
+        auto batch = 0;
+        while (batch < static_cast<int>(batches.size()) &&
+               (room[batch] < lengths[input] || static_cast<int>(batches[batch].size()) >= maxSequences))
+        {
+            batch++;
+        }
+
+        if (batch == static_cast<int>(batches.size()))
+        {
+            batches.emplace_back();
+            room.push_back(batchSize);
+        }
+
+        batches[batch].push_back(input);
+        room[batch] -= lengths[input];
+    }
+
+    return batches;
+}
+
+std::vector<std::pair<int, int>> EmbeddingBatchPacker::Chunk(const int length, const int maxChunkLength)
+{
+    std::vector<std::pair<int, int>> chunks;
+
+    if (length <= 0 || maxChunkLength <= 0)
+    {
+        return chunks;
+    }
+
+    // Spread the tokens evenly rather than leaving a short last chunk that says little on its own
+    const auto count = (length + maxChunkLength - 1) / maxChunkLength;
+    for (int i = 0; i < count; i++)
+    {
+        chunks.emplace_back(length * i / count, length * (i + 1) / count);
+    }
+
+    return chunks;
+}
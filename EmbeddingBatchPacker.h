@@ -0,0 +1,36 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGBATCHPACKER_H
+#define GAME3_EMBEDDINGBATCHPACKER_H
+
+#include <utility>
+#include <vector>
+
+/**
+ * Works out which inputs to decode together so that each batch is as full as it can be. Filling batches in the order
+ * the inputs come leaves a gap whenever the next input doesn't fit, which adds up when the lengths vary a lot.
+ * Instead the longest inputs are placed first, each in the first batch with room for it (first fit decreasing), and
+ * the short ones fill the gaps that are left.
+ */
+class EmbeddingBatchPacker
+{
+public:
+    /**
+     * @param lengths number of tokens in each input, none can be more than batchSize
+     * @param batchSize most tokens in one batch
+     * @param maxSequences most inputs in one batch
+     * @return the index of each input in each batch, every input is in exactly one batch
+     */
+    static std::vector<std::vector<int>> Pack(const std::vector<int> &lengths, int batchSize, int maxSequences);
+
+    /**
+     * Where to split an input that is too long for one batch into nearly equal chunks, e.g. 10 tokens with at most 4
+     * per chunk is {0, 3}, {3, 6}, {6, 10}
+     * @return the [begin, end) of each chunk
+     */
+    static std::vector<std::pair<int, int>> Chunk(int length, int maxChunkLength);
+};
+
+#endif //GAME3_EMBEDDINGBATCHPACKER_H
@@ -0,0 +1,81 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "EmbeddingCache.h"
+
+#include "ContentHash.h"
+
+const std::vector<float>* EmbeddingCache::Find(const std::string &text)
+{
+    const auto entry = Lookup(text);
+
+    return entry != entries.end() ? &entry->embedding : nullptr;
+}
+
+std::list<EmbeddingCache::Entry>::iterator EmbeddingCache::Lookup(const std::string &text)
+{
+    const auto [first, last] = index.equal_range(ContentHash(text));
+
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->second->text != text) continue;
+
+        // Move it to the front as it is now the most recently used
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second;
+    }
+
+    return entries.end();
+}
+
+void EmbeddingCache::Insert(const std::string &text, const float* embedding, const int n_embd)
+{
+    if (capacity == 0) return;
+
+    if (const auto existing = Lookup(text); existing != entries.end())
+    {
+        // Already cached (and now at the front), just refresh the values
+        existing->embedding.assign(embedding, embedding + n_embd);
+        return;
+    }
+
+    const auto hash = ContentHash(text);
+
+    entries.push_front({hash, text, std::vector<float>(embedding, embedding + n_embd)});
+    index.emplace(hash, entries.begin());
+
+    EvictToCapacity();
+}
+
+void EmbeddingCache::SetCapacity(const size_t newCapacity)
+{
+    capacity = newCapacity;
+    EvictToCapacity();
+}
+
+void EmbeddingCache::Clear()
+{
+    entries.clear();
+    index.clear();
+}
+
+void EmbeddingCache::EvictToCapacity()
+{
+    while (entries.size() > capacity)
+    {
+        const auto leastRecentlyUsed = std::prev(entries.end());
+        const auto [first, last] = index.equal_range(leastRecentlyUsed->hash);
+
+        for (auto it = first; it != last; ++it)
+        {
+            if (it->second == leastRecentlyUsed)
+            {
+                index.erase(it);
+                break;
+            }
+        }
+
+        entries.erase(leastRecentlyUsed);
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGCACHE_H
+#define GAME3_EMBEDDINGCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Least recently used cache of embedding vectors keyed by a hash of the text they were computed from.
+ * Looking up a text that has been embedded before costs a hash probe instead of a model forward pass.
+ */
+class EmbeddingCache
+{
+public:
+    explicit EmbeddingCache(size_t capacity = 4096) : capacity(capacity) {}
+
+    // Returns the cached embedding for the text or nullptr if it is not cached. Marks it as recently used.
+    const std::vector<float>* Find(const std::string &text);
+
+    // Caches the embedding for the text, evicting the least recently used embedding if the cache is full
+    void Insert(const std::string &text, const float* embedding, int n_embd);
+
+    void SetCapacity(size_t newCapacity);
+    void Clear();
+
+    [[nodiscard]] size_t Size() const { return entries.size(); }
+    [[nodiscard]] size_t GetCapacity() const { return capacity; }
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        std::string text; // kept to rule out hash collisions
+        std::vector<float> embedding;
+    };
+
+    std::list<Entry>::iterator Lookup(const std::string &text);
+    void EvictToCapacity();
+
+    size_t capacity;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+};
+
+#endif //GAME3_EMBEDDINGCACHE_H
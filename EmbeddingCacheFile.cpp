@@ -0,0 +1,420 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "EmbeddingCacheFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "ContentHash.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char magic[8] = { 'G', '3', 'E', 'M', 'B', 'E', 'D', '\0' };
+    constexpr size_t alignment = 64;
+
+    constexpr size_t AlignUp(const size_t value)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t NextPowerOfTwo(uint64_t value)
+    {
+        uint64_t power = 1;
+        while (power < value) power <<= 1;
+        return power;
+    }
+}
+
+struct EmbeddingCacheFile::Header
+{
+    char magic[8];
+    uint32_t version; // 0 while the file is being rearranged, so a crash part way through is detected
+    uint32_t n_embd;
+    int32_t normalisation;
+    uint32_t unused;
+    uint64_t modelHash;
+    uint64_t rowCount;
+    uint64_t capacity;
+    uint64_t slotCount; // a power of two
+    uint64_t slotsOffset;
+    uint64_t rowsOffset;
+    uint64_t rowStride;
+};
+
+struct EmbeddingCacheFile::Slot
+{
+    uint64_t hash;
+    uint64_t rowPlusOne; // 0 if the slot is empty
+};
+
+struct EmbeddingCacheFile::RowKey
+{
+    uint64_t hash;
+    uint64_t check; // a second hash of the text, so that two texts with the same hash aren't confused
+};
+
+EmbeddingCacheFile::~EmbeddingCacheFile()
+{
+    Close();
+}
+
+bool EmbeddingCacheFile::Open(const std::string &path, const uint64_t modelHash, const int n_embd, const int normalisation,
+                              const size_t initialCapacity)
+{
+    Close();
+    this->path = path;
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = nullptr;
+        fprintf(stderr, "%s: error: unable to open %s\n", __func__, path.c_str());
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    const auto existingSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+    file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file == -1)
+    {
+        fprintf(stderr, "%s: error: unable to open %s\n", __func__, path.c_str());
+        return false;
+    }
+    const auto existingSize = static_cast<size_t>(lseek(file, 0, SEEK_END));
+#endif
+
+    if (existingSize >= sizeof(Header) && Map(existingSize))
+    {
+        const bool matches = std::memcmp(header->magic, magic, sizeof(magic)) == 0 &&
+                             header->version == version &&
+                             header->modelHash == modelHash &&
+                             header->n_embd == static_cast<uint32_t>(n_embd) &&
+                             header->normalisation == normalisation &&
+                             FitsIn(existingSize);
+        if (matches)
+        {
+            return true;
+        }
+
+        // Made by another model (or damaged), start again
+        fprintf(stderr, "%s: %s does not match the embedding model, discarding it\n", __func__, path.c_str());
+    }
+
+    Initialise(modelHash, n_embd, normalisation, std::max<size_t>(initialCapacity, 1));
+
+    return IsOpen();
+}
+
+bool EmbeddingCacheFile::FitsIn(const size_t fileSize) const
+{
+    // Each size is checked against what is left of the file before it is multiplied, so a damaged header can't overflow
+    const bool slotsFit = header->slotsOffset >= sizeof(Header) && header->slotsOffset <= fileSize &&
+                          header->slotCount <= (fileSize - header->slotsOffset) / sizeof(Slot) &&
+                          header->slotsOffset + header->slotCount * sizeof(Slot) <= header->rowsOffset;
+
+    // Lookups probe until they find an empty slot, so there must always be one
+    const bool slotsUsable = header->slotCount > header->capacity && (header->slotCount & (header->slotCount - 1)) == 0;
+
+    const bool rowsFit = header->rowStride >= alignment + header->n_embd * sizeof(float) && header->rowsOffset <= fileSize &&
+                         header->capacity <= (fileSize - header->rowsOffset) / header->rowStride;
+
+    return slotsFit && slotsUsable && rowsFit && header->rowCount <= header->capacity;
+}
+
+void EmbeddingCacheFile::Initialise(const uint64_t modelHash, const int n_embd, const int normalisation, const size_t capacity)
+{
+    const uint64_t slotCount = NextPowerOfTwo(capacity * 2);
+    const uint64_t slotsOffset = AlignUp(sizeof(Header));
+    const uint64_t rowsOffset = AlignUp(slotsOffset + slotCount * sizeof(Slot));
+    const uint64_t rowStride = alignment + AlignUp(n_embd * sizeof(float));
+
+    Unmap();
+    if (!Map(rowsOffset + capacity * rowStride))
+    {
+        return;
+    }
+
+    // Fresh mappings of a newly sized file read as zero, but an old file may have left data behind
+    std::memset(mapping, 0, rowsOffset);
+
+    std::memcpy(header->magic, magic, sizeof(magic));
+    header->version = version;
+    header->n_embd = n_embd;
+    header->normalisation = normalisation;
+    header->modelHash = modelHash;
+    header->rowCount = 0;
+    header->capacity = capacity;
+    header->slotCount = slotCount;
+    header->slotsOffset = slotsOffset;
+    header->rowsOffset = rowsOffset;
+    header->rowStride = rowStride;
+}
+
+void EmbeddingCacheFile::Close()
+{
+    Unmap();
+
+#ifdef _WIN32
+    if (file != nullptr)
+    {
+        CloseHandle(file);
+        file = nullptr;
+    }
+#else
+    if (file != -1)
+    {
+        close(file);
+        file = -1;
+    }
+#endif
+}
+
+const float* EmbeddingCacheFile::Find(const std::string &text) const
+{
+    if (!IsOpen())
+    {
+        return nullptr;
+    }
+
+    const uint64_t hash = ContentHash(text);
+    const int64_t row = FindRow(hash, ContentHash(text, hash));
+
+    return row >= 0 ? reinterpret_cast<const float*>(Row(row) + alignment) : nullptr;
+}
+
+bool EmbeddingCacheFile::Insert(const std::string &text, const float* embedding)
+{
+    if (!IsOpen())
+    {
+        return false;
+    }
+
+    const uint64_t hash = ContentHash(text);
+    const uint64_t check = ContentHash(text, hash);
+
+    if (FindRow(hash, check) >= 0)
+    {
+        return true;
+    }
+
+    if (header->rowCount == header->capacity && !Grow())
+    {
+        return false;
+    }
+
+    const uint64_t row = header->rowCount;
+    unsigned char* destination = Row(row);
+    const RowKey key = { hash, check };
+    std::memcpy(destination, &key, sizeof(key));
+    std::memcpy(destination + alignment, embedding, header->n_embd * sizeof(float));
+
+    // Linear probing, there is always an empty slot as there are twice as many slots as rows
+    Slot* slots = Slots();
+    const uint64_t mask = header->slotCount - 1;
+    uint64_t slot = hash & mask;
+    while (slots[slot].rowPlusOne != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = { hash, row + 1 };
+
+    header->rowCount++;
+
+    return true;
+}
+
+void EmbeddingCacheFile::Flush() const
+{
+    if (!IsOpen()) return;
+
+#ifdef _WIN32
+    FlushViewOfFile(mapping, mappingSize);
+#else
+    msync(mapping, mappingSize, MS_ASYNC);
+#endif
+}
+
+size_t EmbeddingCacheFile::Size() const
+{
+    return IsOpen() ? header->rowCount : 0;
+}
+
+size_t EmbeddingCacheFile::GetCapacity() const
+{
+    return IsOpen() ? header->capacity : 0;
+}
+
+uint64_t EmbeddingCacheFile::HashModelFile(const std::string &modelPath)
+{
+    uint64_t hash = ContentHash(modelPath);
+
+    std::error_code error;
+    const auto size = std::filesystem::file_size(modelPath, error);
+    if (!error)
+    {
+        hash = ContentHash(std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)), hash);
+    }
+
+    const auto modified = std::filesystem::last_write_time(modelPath, error).time_since_epoch().count();
+    if (!error)
+    {
+        hash = ContentHash(std::string_view(reinterpret_cast<const char*>(&modified), sizeof(modified)), hash);
+    }
+
+    return hash;
+}
+
+bool EmbeddingCacheFile::Grow()
+{
+    // Double the rows and the index. The rows move further into the file to make room for the bigger index.
+    const uint64_t rowCount = header->rowCount;
+    const uint64_t oldRowsOffset = header->rowsOffset;
+    const uint64_t rowStride = header->rowStride;
+    const uint64_t capacity = header->capacity * 2;
+    const uint64_t slotCount = NextPowerOfTwo(capacity * 2);
+    const uint64_t rowsOffset = AlignUp(header->slotsOffset + slotCount * sizeof(Slot));
+
+    header->version = 0;
+
+    Unmap();
+    if (!Map(rowsOffset + capacity * rowStride))
+    {
+        return false;
+    }
+
+    std::memmove(mapping + rowsOffset, mapping + oldRowsOffset, rowCount * rowStride);
+
+    header->capacity = capacity;
+    header->slotCount = slotCount;
+    header->rowsOffset = rowsOffset;
+    RebuildIndex();
+    header->version = version;
+
+    return true;
+}
+
+void EmbeddingCacheFile::RebuildIndex()
+{
+    Slot* slots = Slots();
+    std::memset(slots, 0, header->slotCount * sizeof(Slot));
+
+    const uint64_t mask = header->slotCount - 1;
+    for (uint64_t row = 0; row < header->rowCount; row++)
+    {
+        RowKey key;
+        std::memcpy(&key, Row(row), sizeof(key));
+
+        uint64_t slot = key.hash & mask;
+        while (slots[slot].rowPlusOne != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = { key.hash, row + 1 };
+    }
+}
+
+int64_t EmbeddingCacheFile::FindRow(const uint64_t hash, const uint64_t check) const
+{
+    const Slot* slots = Slots();
+    const uint64_t mask = header->slotCount - 1;
+
+    for (uint64_t slot = hash & mask; slots[slot].rowPlusOne != 0; slot = (slot + 1) & mask)
+    {
+        if (slots[slot].hash != hash) continue;
+
+        const uint64_t row = slots[slot].rowPlusOne - 1;
+        RowKey key;
+        std::memcpy(&key, Row(row), sizeof(key));
+
+        if (key.check == check)
+        {
+            return static_cast<int64_t>(row);
+        }
+    }
+
+    return -1;
+}
+
+EmbeddingCacheFile::Slot* EmbeddingCacheFile::Slots() const
+{
+    return reinterpret_cast<Slot*>(mapping + header->slotsOffset);
+}
+
+unsigned char* EmbeddingCacheFile::Row(const uint64_t row) const
+{
+    return mapping + header->rowsOffset + row * header->rowStride;
+}
+
+bool EmbeddingCacheFile::Map(const size_t size)
+{
+#ifdef _WIN32
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = static_cast<LONGLONG>(size);
+    // Mapping a size bigger than the file extends it
+    fileMapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, fileSize.HighPart, fileSize.LowPart, nullptr);
+    if (fileMapping == nullptr)
+    {
+        fprintf(stderr, "%s: error: unable to map %s\n", __func__, path.c_str());
+        return false;
+    }
+    mapping = static_cast<unsigned char*>(MapViewOfFile(fileMapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+    if (mapping == nullptr)
+    {
+        CloseHandle(fileMapping);
+        fileMapping = nullptr;
+        fprintf(stderr, "%s: error: unable to map %s\n", __func__, path.c_str());
+        return false;
+    }
+#else
+    const auto existingSize = static_cast<size_t>(lseek(file, 0, SEEK_END));
+    if (existingSize < size && ftruncate(file, static_cast<off_t>(size)) != 0)
+    {
+        fprintf(stderr, "%s: error: unable to resize %s\n", __func__, path.c_str());
+        return false;
+    }
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (address == MAP_FAILED)
+    {
+        fprintf(stderr, "%s: error: unable to map %s\n", __func__, path.c_str());
+        return false;
+    }
+    mapping = static_cast<unsigned char*>(address);
+#endif
+
+    mappingSize = size;
+    header = reinterpret_cast<Header*>(mapping);
+    return true;
+}
+
+void EmbeddingCacheFile::Unmap()
+{
+    if (mapping == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapping);
+    CloseHandle(fileMapping);
+    fileMapping = nullptr;
+#else
+    munmap(mapping, mappingSize);
+#endif
+
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+}
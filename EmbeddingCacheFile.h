@@ -0,0 +1,92 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGCACHEFILE_H
+#define GAME3_EMBEDDINGCACHEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Embeddings persisted in a memory-mapped file so they don't have to be recomputed every run. Looking one up reads
+ * straight out of the mapping: there is no parsing when the file is opened and nothing is allocated per row.
+ *
+ * Layout (all offsets from the start of the file):
+ *   Header   magic, version, the model hash, n_embd and normalisation the embeddings were made with, sizes/offsets
+ *   Index    open addressing table of {text hash, row + 1}, twice as many slots as rows, 0 marks an empty slot
+ *   Rows     each 64 byte aligned: the text's two hashes, padding, then n_embd floats
+ *
+ * A file made with a different model, n_embd or normalisation (or an older version of the format) is discarded when
+ * it is opened, so changing the embedding model can never return stale embeddings.
+ */
+class EmbeddingCacheFile
+{
+public:
+    EmbeddingCacheFile() = default;
+    EmbeddingCacheFile(const EmbeddingCacheFile &) = delete;
+    EmbeddingCacheFile &operator=(const EmbeddingCacheFile &) = delete;
+    ~EmbeddingCacheFile();
+
+    /**
+     * Opens the file, creating it (or starting it again) if it doesn't exist or doesn't match.
+     * @param modelHash identifies the embedding model, see HashModelFile
+     * @param initialCapacity number of rows to make room for in a new file, it grows as needed
+     * @return false if the file could not be created or mapped
+     */
+    bool Open(const std::string &path, uint64_t modelHash, int n_embd, int normalisation, size_t initialCapacity = 1024);
+
+    // Unmaps and closes the file, everything inserted so far stays in it
+    void Close();
+
+    /**
+     * @return the embedding for the text (n_embd floats in the mapping) or nullptr if it isn't in the file. The file
+     * is mapped again when an Insert grows it, so copy the embedding out before inserting anything else.
+     */
+    [[nodiscard]] const float* Find(const std::string &text) const;
+
+    // Adds the embedding for the text, growing the file if it is full. Does nothing if the text is already there.
+    bool Insert(const std::string &text, const float* embedding);
+
+    // Asks the OS to write the mapping out to disk now rather than whenever it chooses
+    void Flush() const;
+
+    [[nodiscard]] bool IsOpen() const { return header != nullptr; }
+    [[nodiscard]] size_t Size() const;
+    [[nodiscard]] size_t GetCapacity() const;
+
+    // Identifies a model file by its path, size and modification time, so a different or updated model gets a new hash
+    static uint64_t HashModelFile(const std::string &modelPath);
+
+    static constexpr uint32_t version = 1;
+
+private:
+    struct Header;
+    struct Slot;
+    struct RowKey;
+
+    bool Map(size_t size);
+    void Unmap();
+    bool Grow();
+    [[nodiscard]] bool FitsIn(size_t fileSize) const;
+    void Initialise(uint64_t modelHash, int n_embd, int normalisation, size_t capacity);
+    void RebuildIndex();
+    [[nodiscard]] Slot* Slots() const;
+    [[nodiscard]] unsigned char* Row(uint64_t row) const;
+    [[nodiscard]] int64_t FindRow(uint64_t hash, uint64_t check) const;
+
+    std::string path;
+    Header* header = nullptr;
+    unsigned char* mapping = nullptr;
+    size_t mappingSize = 0;
+
+#ifdef _WIN32
+    void* file = nullptr;
+    void* fileMapping = nullptr;
+#else
+    int file = -1;
+#endif
+};
+
+#endif //GAME3_EMBEDDINGCACHEFILE_H
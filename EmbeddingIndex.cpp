@@ -0,0 +1,206 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "EmbeddingIndex.h"
+
+#include <algorithm>
+
+#include "VectorKernels.h"
+
+namespace
+{
+    // Each thread quantises its queries into its own buffers, so preparing a query doesn't allocate and a const index
+    // can be searched from several threads at once
+    thread_local std::vector<int8_t> queryQuantised;
+    thread_local std::vector<uint64_t> queryBits;
+}
+
+EmbeddingIndex::EmbeddingIndex(const int n_embd, const EmbeddingStorage storage) : n_embd(n_embd), words((n_embd + 63) / 64), storage(storage)
+{
+}
+
+int EmbeddingIndex::Add(const float* embedding)
+{
+    const size_t offset = static_cast<size_t>(count) * n_embd;
+
+    if (storage == EmbeddingStorage::Float32)
+    {
+        vectors.insert(vectors.end(), embedding, embedding + n_embd);
+    }
+    else if (storage == EmbeddingStorage::Int8)
+    {
+        quantised.resize(offset + n_embd);
+        scales.push_back(QuantiseInt8(embedding, quantised.data() + offset, n_embd));
+    }
+    else
+    {
+        bits.resize(static_cast<size_t>(count + 1) * words);
+        scales.push_back(QuantiseBinary(embedding, bits.data() + static_cast<size_t>(count) * words, n_embd));
+    }
+
+    return count++;
+}
+
+int EmbeddingIndex::AddAll(const float* embeddings, const int count)
+{
+    Reserve(this->count + count);
+
+    const int first = this->count;
+    for (int i = 0; i < count; i++)
+    {
+        Add(embeddings + static_cast<size_t>(i) * n_embd);
+    }
+
+    return first;
+}
+
+float EmbeddingIndex::Score(const float* query, const int id) const
+{
+    // One vector isn't worth quantising the query for
+    if (storage == EmbeddingStorage::Int8)
+    {
+        return DotF32I8(query, quantised.data() + static_cast<size_t>(id) * n_embd, n_embd) * scales[id];
+    }
+
+    return Score(Prepare(query), id);
+}
+
+EmbeddingIndex::PreparedQuery EmbeddingIndex::Prepare(const float* query) const
+{
+    PreparedQuery prepared;
+    prepared.values = query;
+
+    // Quantising the query as well lets the whole dot product be done in integers
+    if (storage == EmbeddingStorage::Int8)
+    {
+        queryQuantised.resize(n_embd);
+        prepared.quantised = queryQuantised.data();
+        prepared.scale = QuantiseInt8(query, queryQuantised.data(), n_embd);
+    }
+    else if (storage == EmbeddingStorage::Binary)
+    {
+        queryBits.resize(words);
+        prepared.bits = queryBits.data();
+        prepared.scale = QuantiseBinary(query, queryBits.data(), n_embd);
+    }
+
+    return prepared;
+}
+
+float EmbeddingIndex::Score(const PreparedQuery &query, const int id) const
+{
+    if (storage == EmbeddingStorage::Float32)
+    {
+        return DotF32(query.values, vectors.data() + static_cast<size_t>(id) * n_embd, n_embd);
+    }
+
+    if (storage == EmbeddingStorage::Int8)
+    {
+        return static_cast<float>(DotI8(query.quantised, quantised.data() + static_cast<size_t>(id) * n_embd, n_embd)) * query.scale * scales[id];
+    }
+
+    // Matching signs add, differing ones take away
+    const int distance = HammingDistance(query.bits, bits.data() + static_cast<size_t>(id) * words, words);
+    return static_cast<float>(n_embd - 2 * distance) * query.scale * scales[id];
+}
+
+const float* EmbeddingIndex::GetEmbedding(const int id) const
+{
+    return storage == EmbeddingStorage::Float32 ? vectors.data() + static_cast<size_t>(id) * n_embd : nullptr;
+}
+
+std::vector<EmbeddingMatch> EmbeddingIndex::Search(const float* query, const int k) const
+{
+    std::vector<EmbeddingMatch> best;
+
+    if (k <= 0)
+    {
+        return best;
+    }
+
+    best.reserve(std::min(k, count) + 1);
+
+    const auto prepared = Prepare(query);
+
+    // A min-heap of the best k so far, its top is the match to beat
+    const auto worseFirst = [](const EmbeddingMatch &a, const EmbeddingMatch &b)
+    {
+        return a.score > b.score;
+    };
+
+    for (int id = 0; id < count; id++)
+    {
+        const float score = Score(prepared, id);
+
+        if (static_cast<int>(best.size()) < k)
+        {
+            best.push_back({id, score});
+            std::push_heap(best.begin(), best.end(), worseFirst);
+        }
+        else if (score > best.front().score)
+        {
+            std::pop_heap(best.begin(), best.end(), worseFirst);
+            best.back() = {id, score};
+            std::push_heap(best.begin(), best.end(), worseFirst);
+        }
+    }
+
+    // Best first
+    std::sort_heap(best.begin(), best.end(), worseFirst);
+
+    return best;
+}
+
+std::vector<EmbeddingMatch> EmbeddingIndex::SearchAndRerank(const float* query, const int k, const int candidates, const float* originals) const
+{
+    auto matches = Search(query, std::max(k, candidates));
+
+    for (auto &match : matches)
+    {
+        match.score = DotF32(query, originals + static_cast<size_t>(match.id) * n_embd, n_embd);
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const EmbeddingMatch &a, const EmbeddingMatch &b) { return a.score > b.score; });
+
+    if (static_cast<int>(matches.size()) > k)
+    {
+        matches.resize(std::max(k, 0));
+    }
+
+    return matches;
+}
+
+void EmbeddingIndex::Reserve(const int count)
+{
+    const size_t size = static_cast<size_t>(count) * n_embd;
+
+    if (storage == EmbeddingStorage::Float32)
+    {
+        vectors.reserve(size);
+    }
+    else if (storage == EmbeddingStorage::Int8)
+    {
+        quantised.reserve(size);
+        scales.reserve(count);
+    }
+    else
+    {
+        bits.reserve(static_cast<size_t>(count) * words);
+        scales.reserve(count);
+    }
+}
+
+void EmbeddingIndex::Clear()
+{
+    vectors.clear();
+    quantised.clear();
+    bits.clear();
+    scales.clear();
+    count = 0;
+}
+
+size_t EmbeddingIndex::GetMemoryUsage() const
+{
+    return vectors.size() * sizeof(float) + quantised.size() * sizeof(int8_t) + bits.size() * sizeof(uint64_t) + scales.size() * sizeof(float);
+}
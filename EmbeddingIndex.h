@@ -0,0 +1,104 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGINDEX_H
+#define GAME3_EMBEDDINGINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How the index holds its vectors
+enum class EmbeddingStorage
+{
+    Float32, // exact scores
+    Int8,    // a quarter of the memory, scores are approximate
+    Binary   // one bit per dimension, a thirty-second of the memory, scores are rough so rerank with SearchAndRerank
+};
+
+struct EmbeddingMatch
+{
+    int id;      // the id returned when the vector was added
+    float score; // dot product with the query, the cosine similarity for normalised embeddings
+};
+
+/**
+ * Searches a set of embeddings (e.g. one per room description) for those most similar to a query embedding.
+ * All vectors are kept one after the other in a single allocation and compared with SIMD dot products, so a query
+ * is a single linear pass over memory. EmbeddingLLM normalises its embeddings, so the scores are cosine similarities.
+ */
+class EmbeddingIndex
+{
+public:
+    explicit EmbeddingIndex(int n_embd, EmbeddingStorage storage = EmbeddingStorage::Float32);
+
+    /**
+     * @param embedding n_embd floats
+     * @return the id of the vector, ids count up from 0 in the order vectors are added
+     */
+    int Add(const float* embedding);
+
+    // Adds count vectors stored one after the other (e.g. EmbeddingMatrix::data), returns the id of the first
+    int AddAll(const float* embeddings, int count);
+
+    /**
+     * @param query n_embd floats
+     * @param k maximum number of matches to return
+     * @return the k best matches, highest score first
+     */
+    [[nodiscard]] std::vector<EmbeddingMatch> Search(const float* query, int k) const;
+
+    /**
+     * Searches the quantised vectors for the best candidates, then scores just those exactly against the float32
+     * vectors they were made from. The originals don't have to be in memory all the time, e.g. they can be rows
+     * of the EmbeddingCacheFile's mapping, so the index stays small while the order of the best matches is exact.
+     * @param query n_embd floats
+     * @param k maximum number of matches to return
+     * @param candidates how many of the best approximate matches to score again, more gets closer to exact search
+     * @param originals n_embd floats for each id, one after the other in the order they were added
+     * @return the k best matches, highest (exact) score first
+     */
+    [[nodiscard]] std::vector<EmbeddingMatch> SearchAndRerank(const float* query, int k, int candidates, const float* originals) const;
+
+    // Score of a single stored vector against the query. With Int8 storage the query isn't quantised, so this is a
+    // little closer to the exact score than Search's.
+    [[nodiscard]] float Score(const float* query, int id) const;
+
+    // The stored vector, only available with Float32 storage (nullptr otherwise)
+    [[nodiscard]] const float* GetEmbedding(int id) const;
+
+    void Reserve(int count);
+    void Clear();
+
+    [[nodiscard]] int Size() const { return count; }
+    [[nodiscard]] int GetDimensions() const { return n_embd; }
+    [[nodiscard]] EmbeddingStorage GetStorage() const { return storage; }
+
+    // Bytes used to hold the vectors
+    [[nodiscard]] size_t GetMemoryUsage() const;
+
+private:
+    // The query in the same form as the stored vectors, made once for each search
+    struct PreparedQuery
+    {
+        const float* values = nullptr;
+        const int8_t* quantised = nullptr; // Int8: the calling thread's scratch, until it prepares another query
+        const uint64_t* bits = nullptr;    // Binary: likewise
+        float scale = 0;
+    };
+
+    [[nodiscard]] PreparedQuery Prepare(const float* query) const;
+    [[nodiscard]] float Score(const PreparedQuery &query, int id) const;
+
+    int n_embd;
+    int words; // Binary: 64 bit words per vector
+    EmbeddingStorage storage;
+    int count = 0;
+    std::vector<float> vectors;    // Float32: count * n_embd
+    std::vector<int8_t> quantised; // Int8: count * n_embd
+    std::vector<uint64_t> bits;    // Binary: count * words
+    std::vector<float> scales;     // Int8 and Binary: one per vector
+};
+
+#endif //GAME3_EMBEDDINGINDEX_H
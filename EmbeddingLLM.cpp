@@ -1,6 +1,24 @@
 #include "EmbeddingLLM.h"
 
-int EmbeddingLLM::Initialize(const std::string &modelPath)
+#include <atomic>
+#include <deque>
+#include <future>
+#include <thread>
+#include <unordered_map>
+
+#include "EmbeddingBatchPacker.h"
+#include "InferenceThreading.h"
+#include "LLMModelRegistry.h"
+#include <file/SettingsManager.h>
+
+int EmbeddingLLM::InitializeFromSettings()
+{
+    const auto settings = gamelib::SettingsManager::Get();
+
+    return Initialize(settings->GetString("llm", "EmbeddingModelPath"), settings->GetString("llm", "EmbeddingCacheFilePath"));
+}
+
+int EmbeddingLLM::Initialize(const std::string &modelPath, const std::string &cacheFilePath)
 {
     std::string modelLocation = modelPath;
 
@@ -11,7 +29,7 @@ int EmbeddingLLM::Initialize(const std::string &modelPath)
     params.kv_unified = false;
     params.n_ctx = 512;
     params.embedding = true;
-    params.verbose_prompt = true;
+    params.verbose_prompt = false;
 
     // get max number of sequences per batch
     const int n_seq_max = llama_max_parallel_sequences();
@@ -42,12 +60,59 @@ int EmbeddingLLM::Initialize(const std::string &modelPath)
     llama_backend_init();
     llama_numa_init(params.numa);
 
-    // load the model
-    llama_init = common_init_from_params(params);
+    // load the model (or share it if its already loaded) and check out a context for it
+    sharedModel = LLMModelRegistry::Get()->AcquireModel(params.model.path, common_model_params_to_llama(params));
+    sharedContext = LLMModelRegistry::Get()->AcquireContext(sharedModel, common_context_params_to_llama(params));
+
+    model = sharedModel.get();
+    ctx = sharedContext.get();
+
+    if (model == nullptr || ctx == nullptr)
+    {
+        return 1;
+    }
+
+    if (llama_model_has_encoder(model) && llama_model_has_decoder(model))
+    {
+        printf("%s: computing embeddings in encoder-decoder models is not supported\n", __func__);
+        return 1;
+    }
+
+    const int n_ctx_train = llama_model_n_ctx_train(model);
+    const int n_ctx = llama_n_ctx(ctx);
+
+    if (n_ctx > n_ctx_train)
+    {
+        printf("%s: warning: model was trained on only %d context tokens (%d specified)\n",
+               __func__, n_ctx_train, n_ctx);
+    }
+
+    // The batch is reused by every call, and cached embeddings from a previous model are no use
+    llama_batch_free(batch);
+    batch = llama_batch_init(params.n_batch, 0, 1);
+    cache.Clear();
+
+    if (!cacheFilePath.empty() && !OpenCacheFile(cacheFilePath))
+    {
+        return 1;
+    }
 
     return 0;
 }
 
+bool EmbeddingLLM::OpenCacheFile(const std::string &path)
+{
+    if (model == nullptr)
+    {
+        printf("%s: the model needs to be loaded first\n", __func__);
+        return false;
+    }
+
+    const auto modelHash = EmbeddingCacheFile::HashModelFile(params.model.path);
+
+    return cacheFile.Open(path, modelHash, GetEmbeddingModelDimensions(), params.embd_normalize);
+}
+
 int EmbeddingLLM::GetEmbeddingModelDimensions() const
 {
     return llama_model_n_embd(model);
@@ -77,11 +142,6 @@ std::vector<float> EmbeddingLLM::GetEmbedding(std::string prompt)
 {
     std::vector<float> embeddings;
 
-    model = llama_init.model.get();
-    ctx = llama_init.context.get();
-
-    const int n_seq_max = llama_max_parallel_sequences();
-
     params.prompt = prompt;
 
     if (model == nullptr)
@@ -90,177 +150,428 @@ std::vector<float> EmbeddingLLM::GetEmbedding(std::string prompt)
         return embeddings;
     }
 
-    const llama_vocab* vocab = llama_model_get_vocab(model);
+    // split the prompt into lines
+    const std::vector<std::string> prompts = split_lines(params.prompt, params.embd_sep);
 
-    const int n_ctx_train = llama_model_n_ctx_train(model);
-    const int n_ctx = llama_n_ctx(ctx);
+    if (llama_pooling_type(ctx) != LLAMA_POOLING_TYPE_NONE)
+    {
+        // one vector per line, which can come from the cache
+        return GetEmbeddings(prompts).data;
+    }
 
-    const enum llama_pooling_type pooling_type = llama_pooling_type(ctx);
+    // Without pooling there is a vector per token, these are not cached
+    const auto inputs = TokenizeAll(prompts, 0, prompts.size(), InferenceThreading::Get()->GetPromptThreads());
 
-    if (llama_model_has_encoder(model) && llama_model_has_decoder(model))
+    int n_embd_count = 0;
+    for (const auto& inp : inputs)
     {
-        printf("%s: computing embeddings in encoder-decoder models is not supported\n", __func__);
-        return embeddings;
+        if (inp.empty())
+        {
+            return embeddings;
+        }
+        n_embd_count += static_cast<int>(inp.size());
     }
 
-    if (n_ctx > n_ctx_train)
+    PrintInputs(prompts, 0, inputs);
+
+    // allocate output
+    embeddings.resize(static_cast<size_t>(n_embd_count) * GetEmbeddingModelDimensions(), 0);
+
+    if (!EmbedInputs(inputs, embeddings.data()))
     {
-        printf("%s: warning: model was trained on only %d context tokens (%d specified)\n",
-               __func__, n_ctx_train, n_ctx);
+        embeddings.clear();
     }
 
+    // return vector of dimension n_embd (eg.384) such that emb[n_embd-1] is last float in the first vector
+    return embeddings;
+}
 
-    // split the prompt into lines
-    std::vector<std::string> prompts = split_lines(params.prompt, params.embd_sep);
+EmbeddingMatrix EmbeddingLLM::GetEmbeddings(const std::vector<std::string> &texts)
+{
+    EmbeddingMatrix matrix;
 
-    // max batch size
-    const uint64_t n_batch = params.n_batch;
+    if (model == nullptr)
+    {
+        printf("%s: unable to load model\n", __func__);
+        return matrix;
+    }
 
-    // get added sep and eos token, if any
-    const std::string added_sep_token = llama_vocab_get_add_sep(vocab) ? llama_vocab_get_text(vocab, llama_vocab_sep(vocab)) : "";
-    const std::string added_eos_token = llama_vocab_get_add_eos(vocab) ? llama_vocab_get_text(vocab, llama_vocab_eos(vocab)) : "";
-    const char* rerank_prompt = llama_model_chat_template(model, "rerank");
+    if (llama_pooling_type(ctx) == LLAMA_POOLING_TYPE_NONE)
+    {
+        printf("%s: one embedding per text needs a pooling model\n", __func__);
+        return matrix;
+    }
 
-    // tokenize the prompts and trim
-    std::vector<std::vector<int32_t>> inputs;
-    for (const auto& prompt : prompts)
+    matrix.rows = static_cast<int>(texts.size());
+    matrix.n_embd = GetEmbeddingModelDimensions();
+    matrix.data.resize(static_cast<size_t>(matrix.rows) * matrix.n_embd, 0);
+
+    // Fill in what we already have, and collect each distinct text that we don't
+    std::vector<std::string> misses;
+    std::unordered_map<std::string, int> missIndex; // text -> index in misses
+    std::vector<std::pair<int, int>> missRows; // row -> index in misses
+
+    for (int row = 0; row < matrix.rows; row++)
     {
-        std::vector<llama_token> inp;
+        const auto &text = texts[row];
 
-        // split classification pairs and insert expected separator tokens
-        if (pooling_type == LLAMA_POOLING_TYPE_RANK && prompt.find(params.cls_sep) != std::string::npos)
+        if (const auto cached = cache.Find(text))
         {
-            std::vector<std::string> pairs = split_lines(prompt, params.cls_sep);
-            if (rerank_prompt != nullptr) {
-                const std::string query = pairs[0];
-                const std::string doc = pairs[1];
-                std::string final_prompt = rerank_prompt;
-                string_replace_all(final_prompt, "{query}", query);
-                string_replace_all(final_prompt, "{document}", doc);
-                inp = common_tokenize(vocab, final_prompt, true, true);
-            }
-            else
+            std::copy(cached->begin(), cached->end(), matrix.data.begin() + static_cast<size_t>(row) * matrix.n_embd);
+            continue;
+        }
+
+        // Straight out of the file's mapping
+        if (const auto stored = cacheFile.Find(text))
+        {
+            std::copy(stored, stored + matrix.n_embd, matrix.data.begin() + static_cast<size_t>(row) * matrix.n_embd);
+            continue;
+        }
+
+        auto [it, inserted] = missIndex.try_emplace(text, static_cast<int>(misses.size()));
+        if (inserted)
+        {
+            misses.push_back(text);
+        }
+        missRows.emplace_back(row, it->second);
+    }
+
+    if (misses.empty())
+    {
+        return matrix;
+    }
+
+    // Embed just the misses, then share them out to every row that asked for them
+    std::vector<float> missEmbeddings(misses.size() * matrix.n_embd, 0);
+
+    // The first wave is tokenized by every thread there is. After that each wave is tokenized on a background thread
+    // while the one before it is decoded, so the model isn't left waiting for the tokenizer.
+    const auto waveEnd = [&](const size_t begin) { return std::min(begin + textsPerWave, misses.size()); };
+    auto inputs = TokenizeAll(misses, 0, waveEnd(0), InferenceThreading::Get()->GetPromptThreads());
+
+    for (size_t begin = 0; begin < misses.size(); begin = waveEnd(begin))
+    {
+        const auto end = waveEnd(begin);
+
+        // Waited for before returning, even on failure, as it uses misses
+        std::future<std::vector<std::vector<llama_token>>> nextInputs;
+        if (end < misses.size())
+        {
+            nextInputs = std::async(std::launch::async, [&, end] { return TokenizeAll(misses, end, waveEnd(end), 1); });
+        }
+
+        if (std::any_of(inputs.begin(), inputs.end(), [](const auto &inp) { return inp.empty(); }))
+        {
+            return {};
+        }
+
+        PrintInputs(misses, begin, inputs);
+
+        if (!EmbedInputs(inputs, missEmbeddings.data() + begin * matrix.n_embd))
+        {
+            return {};
+        }
+
+        if (nextInputs.valid())
+        {
+            inputs = nextInputs.get();
+        }
+    }
+
+    for (int i = 0; i < static_cast<int>(misses.size()); i++)
+    {
+        const float* embedding = missEmbeddings.data() + static_cast<size_t>(i) * matrix.n_embd;
+        cache.Insert(misses[i], embedding, matrix.n_embd);
+        cacheFile.Insert(misses[i], embedding);
+    }
+
+    for (const auto &[row, miss] : missRows)
+    {
+        const auto source = missEmbeddings.begin() + static_cast<size_t>(miss) * matrix.n_embd;
+        std::copy(source, source + matrix.n_embd, matrix.data.begin() + static_cast<size_t>(row) * matrix.n_embd);
+    }
+
+    return matrix;
+}
+
+std::vector<llama_token> EmbeddingLLM::TokenizePrompt(const std::string &prompt) const
+{
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+    const enum llama_pooling_type pooling_type = llama_pooling_type(ctx);
+
+    std::vector<llama_token> inp;
+
+    // split classification pairs and insert expected separator tokens
+    if (pooling_type == LLAMA_POOLING_TYPE_RANK && prompt.find(params.cls_sep) != std::string::npos)
+    {
+        // get added sep and eos token, if any
+        const std::string added_sep_token = llama_vocab_get_add_sep(vocab) ? llama_vocab_get_text(vocab, llama_vocab_sep(vocab)) : "";
+        const std::string added_eos_token = llama_vocab_get_add_eos(vocab) ? llama_vocab_get_text(vocab, llama_vocab_eos(vocab)) : "";
+        const char* rerank_prompt = llama_model_chat_template(model, "rerank");
+
+        std::vector<std::string> pairs = split_lines(prompt, params.cls_sep);
+        if (rerank_prompt != nullptr) {
+            const std::string query = pairs[0];
+            const std::string doc = pairs[1];
+            std::string final_prompt = rerank_prompt;
+            string_replace_all(final_prompt, "{query}", query);
+            string_replace_all(final_prompt, "{document}", doc);
+            inp = common_tokenize(vocab, final_prompt, true, true);
+        }
+        else
+        {
+            std::string final_prompt;
+            for (size_t i = 0; i < pairs.size(); i++)
             {
-                std::string final_prompt;
-                for (size_t i = 0; i < pairs.size(); i++)
+                final_prompt += pairs[i];
+                if (i != pairs.size() - 1)
                 {
-                    final_prompt += pairs[i];
-                    if (i != pairs.size() - 1)
+                    if (!added_eos_token.empty())
                     {
-                        if (!added_eos_token.empty())
-                        {
-                            final_prompt += added_eos_token;
-                        }
-                        if (!added_sep_token.empty())
-                        {
-                            final_prompt += added_sep_token;
-                        }
+                        final_prompt += added_eos_token;
+                    }
+                    if (!added_sep_token.empty())
+                    {
+                        final_prompt += added_sep_token;
                     }
                 }
-                inp = common_tokenize(ctx, final_prompt, true, true);
             }
+            inp = common_tokenize(ctx, final_prompt, true, true);
         }
-        else
-        {
-            inp = common_tokenize(ctx, prompt, true, true);
-        }
-        if (inp.size() > n_batch)
-        {
-            printf("%s: number of tokens in input line (%lld) exceeds batch size (%lld), increase batch size and re-run\n",
-                   __func__, static_cast<long long int>(inp.size()), static_cast<long long int>(n_batch));
-            return embeddings;
-        }
-        inputs.push_back(inp);
+    }
+    else
+    {
+        inp = common_tokenize(ctx, prompt, true, true);
     }
 
     // check if the last token is SEP/EOS
     // it should be automatically added by the tokenizer when 'tokenizer.ggml.add_eos_token' is set to 'true'
-    for (auto& inp : inputs)
+    if (inp.empty() || (inp.back() != llama_vocab_sep(vocab) && inp.back() != llama_vocab_eos(vocab)))
+    {
+        printf("%s: last token in the prompt is not SEP or EOS\n", __func__);
+        printf("%s: 'tokenizer.ggml.add_eos_token' should be set to 'true' in the GGUF header\n", __func__);
+    }
+
+    return inp;
+}
+
+std::vector<std::vector<llama_token>> EmbeddingLLM::TokenizeAll(const std::vector<std::string> &texts, const size_t begin, const size_t end,
+                                                                const int threads) const
+{
+    std::vector<std::vector<llama_token>> inputs(end - begin);
+
+    // Texts are handed out a few at a time, so a thread that gets some long ones doesn't hold up the rest
+    constexpr size_t textsPerTask = 16;
+    std::atomic<size_t> next {begin};
+
+    const auto tokenize = [&]
     {
-        if (inp.empty() || (inp.back() != llama_vocab_sep(vocab) && inp.back() != llama_vocab_eos(vocab)))
+        for (auto first = next.fetch_add(textsPerTask); first < end; first = next.fetch_add(textsPerTask))
         {
-            printf("%s: last token in the prompt is not SEP or EOS\n", __func__);
-            printf("%s: 'tokenizer.ggml.add_eos_token' should be set to 'true' in the GGUF header\n", __func__);
+            for (auto i = first; i < std::min(first + textsPerTask, end); i++)
+            {
+                inputs[i - begin] = TokenizePrompt(texts[i]);
+            }
         }
+    };
+
+    // Only as many threads as there are tasks for, this thread being one of them
+    const auto workerCount = std::min<size_t>(std::max(threads, 1), (end - begin + textsPerTask - 1) / textsPerTask);
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < workerCount; i++)
+    {
+        workers.emplace_back(tokenize);
     }
 
-    // tokenization stats
-    if (params.verbose_prompt)
+    tokenize();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    return inputs;
+}
+
+bool EmbeddingLLM::EmbedInputs(const std::vector<std::vector<llama_token>> &inputs, float* output)
+{
+    const int n_seq_max = llama_max_parallel_sequences();
+    const int n_batch = static_cast<int>(params.n_batch);
+    const int n_embd = GetEmbeddingModelDimensions();
+    const bool perToken = llama_pooling_type(ctx) == LLAMA_POOLING_TYPE_NONE;
+    const llama_vocab* vocab = llama_model_get_vocab(model);
+
+    // What goes into one sequence of a batch: a whole input, or a chunk of one that is too long for a batch
+    struct Piece
     {
-        for (int i = 0; i < static_cast<int>(inputs.size()); i++)
+        int input;
+        int row; // where its first embedding goes in the output
+        const llama_token* tokens;
+        int n_tokens;
+    };
+
+    std::vector<Piece> pieces;
+    pieces.reserve(inputs.size());
+    std::deque<std::vector<llama_token>> framedChunks; // stays put as it grows, the pieces point into it
+    std::vector<int> chunkedTokens(inputs.size(), 0); // how many tokens the chunks of a long input add up to
+
+    int row = 0;
+    for (int i = 0; i < static_cast<int>(inputs.size()); i++)
+    {
+        const auto &inp = inputs[i];
+        const int n_toks = static_cast<int>(inp.size());
+
+        if (n_toks <= n_batch)
+        {
+            pieces.push_back({i, perToken ? row : i, inp.data(), n_toks});
+        }
+        else if (perToken)
+        {
+            // Each token has its own embedding, so the chunks' just follow on from each other
+            for (const auto &[begin, end] : EmbeddingBatchPacker::Chunk(n_toks, n_batch))
+            {
+                pieces.push_back({i, row + begin, inp.data() + begin, end - begin});
+            }
+        }
+        else
         {
-            printf("%s: prompt %d: '%s'\n", __func__, i, prompts[i].c_str());
-            printf("%s: number of tokens in prompt = %zu\n", __func__, inputs[i].size());
-            for (int j = 0; j < static_cast<int>(inputs[i].size()); j++) {
-                printf("%6d -> '%s'\n", inputs[i][j], common_token_to_piece(ctx, inputs[i][j]).c_str());
+            // Each chunk keeps the input's start and end tokens (the pooling may rely on them) and the chunks'
+            // embeddings are averaged, weighted by how many tokens each one has
+            const int lead = inp.front() == llama_vocab_bos(vocab) ? 1 : 0;
+            const int trail = inp.back() == llama_vocab_sep(vocab) || inp.back() == llama_vocab_eos(vocab) ? 1 : 0;
+
+            for (const auto &[begin, end] : EmbeddingBatchPacker::Chunk(n_toks - lead - trail, n_batch - lead - trail))
+            {
+                auto &chunk = framedChunks.emplace_back();
+                chunk.reserve(end - begin + lead + trail);
+                if (lead) chunk.push_back(inp.front());
+                chunk.insert(chunk.end(), inp.begin() + lead + begin, inp.begin() + lead + end);
+                if (trail) chunk.push_back(inp.back());
+
+                pieces.push_back({i, i, chunk.data(), static_cast<int>(chunk.size())});
+                chunkedTokens[i] += static_cast<int>(chunk.size());
             }
-            printf("\n\n");
+
+            std::fill_n(output + static_cast<size_t>(i) * n_embd, n_embd, 0.0f);
         }
+
+        row += n_toks;
     }
 
-    // initialize batch
-    const int n_prompts = prompts.size();
-    struct llama_batch batch = llama_batch_init(n_batch, 0, 1);
+    // Fill each decode as close to n_batch as the lengths allow, whatever order the inputs came in
+    std::vector<int> lengths;
+    lengths.reserve(pieces.size());
+    for (const auto &piece : pieces)
+    {
+        lengths.push_back(piece.n_tokens);
+    }
 
-    // count number of embeddings
-    int n_embd_count = 0;
-    if (pooling_type == LLAMA_POOLING_TYPE_NONE)
+    const auto batches = EmbeddingBatchPacker::Pack(lengths, n_batch, n_seq_max);
+
+    // Each batch is decoded into here and then copied to the rows its pieces belong to
+    std::vector<float> batchOutput(static_cast<size_t>(std::max(n_batch, n_seq_max)) * n_embd);
+
+    for (const auto &batchPieces : batches)
     {
-        for (int k = 0; k < n_prompts; k++)
+        common_batch_clear(batch);
+
+        for (int s = 0; s < static_cast<int>(batchPieces.size()); s++)
         {
-            n_embd_count += inputs[k].size();
+            const auto &piece = pieces[batchPieces[s]];
+            batch_add_seq(batch, piece.tokens, piece.n_tokens, s);
+        }
+
+        if (!batch_decode(ctx, batch, batchOutput.data(), static_cast<int>(batchPieces.size()), n_embd, params.embd_normalize))
+        {
+            return false;
+        }
+
+        int first = 0; // the piece's first token in the batch
+        for (int s = 0; s < static_cast<int>(batchPieces.size()); s++)
+        {
+            const auto &piece = pieces[batchPieces[s]];
+            float* destination = output + static_cast<size_t>(piece.row) * n_embd;
+
+            if (perToken)
+            {
+                const auto source = batchOutput.begin() + static_cast<size_t>(first) * n_embd;
+                std::copy(source, source + static_cast<size_t>(piece.n_tokens) * n_embd, destination);
+            }
+            else if (chunkedTokens[piece.input] > 0)
+            {
+                const float* source = batchOutput.data() + static_cast<size_t>(s) * n_embd;
+                for (int d = 0; d < n_embd; d++)
+                {
+                    destination[d] += source[d] * static_cast<float>(piece.n_tokens);
+                }
+            }
+            else
+            {
+                const auto source = batchOutput.begin() + static_cast<size_t>(s) * n_embd;
+                std::copy(source, source + n_embd, destination);
+            }
+
+            first += piece.n_tokens;
         }
     }
-    else
+
+    // Finish averaging the chunks of long inputs, then normalise them like any other embedding
+    for (int i = 0; i < static_cast<int>(inputs.size()); i++)
     {
-        // How many embedding vectors to create is based on the number of prompts
-        n_embd_count = n_prompts;
+        if (chunkedTokens[i] == 0)
+        {
+            continue;
+        }
+
+        float* embedding = output + static_cast<size_t>(i) * n_embd;
+        for (int d = 0; d < n_embd; d++)
+        {
+            embedding[d] /= static_cast<float>(chunkedTokens[i]);
+        }
+        common_embd_normalize(embedding, embedding, n_embd, params.embd_normalize);
     }
 
+    return true;
+}
 
-    // Get the embedding dimension of the model, eg. d=384
-    const int n_embd = llama_model_n_embd(model);
+void EmbeddingLLM::PrintInputs(const std::vector<std::string> &prompts, const size_t first, const std::vector<std::vector<llama_token>> &inputs) const
+{
+    // tokenization stats
+    if (!params.verbose_prompt)
+    {
+        return;
+    }
 
-    // allocate output
-    embeddings.resize(n_embd_count * n_embd, 0);
-
-    float* emb = embeddings.data();
-
-    // break into batches
-    int e = 0; // number of embeddings already stored
-    int s = 0; // number of prompts in current batch
-    for (int k = 0; k < n_prompts; k++) {
-        // clamp to n_batch tokens
-        auto& inp = inputs[k];
-
-        const uint64_t n_toks = inp.size();
-
-        // encode if at capacity
-        if (batch.n_tokens + n_toks > n_batch || s >= n_seq_max) {
-            float* out = emb + e * n_embd;
-            batch_decode(ctx, batch, out, s, n_embd, params.embd_normalize);
-            e += pooling_type == LLAMA_POOLING_TYPE_NONE ? batch.n_tokens : s;
-            s = 0;
-            common_batch_clear(batch);
+    for (int i = 0; i < static_cast<int>(inputs.size()); i++)
+    {
+        printf("%s: prompt %d: '%s'\n", __func__, static_cast<int>(first) + i, prompts[first + i].c_str());
+        printf("%s: number of tokens in prompt = %zu\n", __func__, inputs[i].size());
+        for (int j = 0; j < static_cast<int>(inputs[i].size()); j++) {
+            printf("%6d -> '%s'\n", inputs[i][j], common_token_to_piece(ctx, inputs[i][j]).c_str());
         }
-
-        // add to batch
-        batch_add_seq(batch, inp, s);
-        s += 1;
+        printf("\n\n");
     }
+}
+
+void EmbeddingLLM::SetVerbose(const bool verbose)
+{
+    params.verbose_prompt = verbose;
+}
 
-    // final batch
-    float* out = emb + e * n_embd;
-    batch_decode(ctx, batch, out, s, n_embd, params.embd_normalize);
+EmbeddingCache &EmbeddingLLM::GetCache()
+{
+    return cache;
+}
 
-    // we have the embedding vectors now, return them
+EmbeddingCacheFile &EmbeddingLLM::GetCacheFile()
+{
+    return cacheFile;
+}
 
-    // clean up
+EmbeddingLLM::~EmbeddingLLM()
+{
     llama_batch_free(batch);
-    llama_backend_free();
-
-    // return vector of dimension n_embd (eg.384) such that emb[n_embd-1] is last float in the first vector
-    return embeddings;
 }
 
 std::vector<std::string> EmbeddingLLM::split_lines(const std::string &s, const std::string &separator)
@@ -280,16 +591,15 @@ std::vector<std::string> EmbeddingLLM::split_lines(const std::string &s, const s
     return lines;
 }
 
-void EmbeddingLLM::batch_add_seq(llama_batch &batch, const std::vector<int32_t> &tokens, llama_seq_id seq_id)
+void EmbeddingLLM::batch_add_seq(llama_batch &batch, const llama_token* tokens, const int n_tokens, llama_seq_id seq_id)
 {
-    size_t n_tokens = tokens.size();
-    for (size_t i = 0; i < n_tokens; i++) {
+    for (int i = 0; i < n_tokens; i++) {
         common_batch_add(batch, tokens[i], i, { seq_id }, true);
     }
 }
 
-void EmbeddingLLM::batch_decode(llama_context *ctx, const llama_batch &batch, float *output, int n_seq, int n_embd,
-    int embd_norm)
+bool EmbeddingLLM::batch_decode(llama_context *ctx, const llama_batch &batch, float *output, int n_seq, int n_embd,
+    int embd_norm) const
 {
     const enum llama_pooling_type pooling_type = llama_pooling_type(ctx);
 
@@ -297,9 +607,13 @@ void EmbeddingLLM::batch_decode(llama_context *ctx, const llama_batch &batch, fl
     llama_memory_clear(llama_get_memory(ctx), true);
 
     // run model
-    printf("%s: n_tokens = %d, n_seq = %d\n", __func__, batch.n_tokens, n_seq);
+    if (params.verbose_prompt)
+    {
+        printf("%s: n_tokens = %d, n_seq = %d\n", __func__, batch.n_tokens, n_seq);
+    }
     if (llama_decode(ctx, batch) < 0) {
         printf("%s : failed to process\n", __func__);
+        return false;
     }
 
     for (int i = 0; i < batch.n_tokens; i++) {
@@ -326,4 +640,6 @@ void EmbeddingLLM::batch_decode(llama_context *ctx, const llama_batch &batch, fl
         float* out = output + embd_pos * n_embd;
         common_embd_normalize(embd, out, n_embd, embd_norm);
     }
+
+    return true;
 }
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 #include "llama.h"
@@ -7,11 +8,43 @@
 #include <ctime>
 #include <algorithm>
 
+#include "EmbeddingCache.h"
+#include "EmbeddingCacheFile.h"
+
+// Embedding vectors stored one after the other in a single allocation, one row per input text
+struct EmbeddingMatrix
+{
+    int rows = 0;
+    int n_embd = 0;
+    std::vector<float> data; // rows * n_embd floats
+
+    [[nodiscard]] const float* Row(const int i) const { return data.data() + static_cast<size_t>(i) * n_embd; }
+};
+
 class EmbeddingLLM
 {
 public:
+    EmbeddingLLM() = default;
+    EmbeddingLLM(const EmbeddingLLM &) = delete;
+    EmbeddingLLM &operator=(const EmbeddingLLM &) = delete;
+    ~EmbeddingLLM();
 
-    int Initialize(const std::string &modelPath = "CompendiumLabs_bge-small-en-v1.5-gguf_bge-small-en-v1.5-q4_k_m.gguf");
+    /**
+     * @param modelPath path to the embedding model gguf file
+     * @param cacheFilePath file to keep embeddings in between runs (see OpenCacheFile), empty for none
+     * @return 0 on success
+     */
+    int Initialize(const std::string &modelPath = "CompendiumLabs_bge-small-en-v1.5-gguf_bge-small-en-v1.5-q4_k_m.gguf",
+                   const std::string &cacheFilePath = "");
+
+    // Initializes with the "llm"/"EmbeddingModelPath" model, keeping its embeddings in "llm"/"EmbeddingCacheFilePath"
+    int InitializeFromSettings();
+
+    /**
+     * Keeps embeddings in a memory-mapped file so later runs can start with them. The file is tied to the model
+     * that was loaded and starts again empty if it was made with a different one.
+     */
+    bool OpenCacheFile(const std::string &path);
 
     int GetEmbeddingModelDimensions() const;
 
@@ -19,13 +52,44 @@ public:
 
     std::vector<float> GetEmbedding(std::string prompt = "Paris is the capital of France.");
 
+    /**
+     * Embeds many texts at once. Texts that have been embedded before (or are repeated in the list) come from the
+     * cache, only the rest go through the model, packed into as few batches as possible (see EmbeddingBatchPacker).
+     * A text too long for one batch is embedded in chunks and the chunks' embeddings averaged.
+     * @return one row per text, in the same order as the texts (empty if the texts could not be embedded)
+     */
+    EmbeddingMatrix GetEmbeddings(const std::vector<std::string> &texts);
+
+    // Prints each prompt's tokens and the size of each decoded batch
+    void SetVerbose(bool verbose);
+
+    EmbeddingCache &GetCache();
+    EmbeddingCacheFile &GetCacheFile();
+
 private:
-    common_init_result llama_init;
+    std::shared_ptr<llama_model> sharedModel {};
+    std::shared_ptr<llama_context> sharedContext {};
     llama_model* model {};
     llama_context* ctx {};
     common_params params {};
+    llama_batch batch {};
+    EmbeddingCache cache;
+    EmbeddingCacheFile cacheFile;
+
+    // Misses are tokenized and embedded this many at a time, so that tokenizing the next lot overlaps embedding these
+    static constexpr size_t textsPerWave = 256;
+
+    [[nodiscard]] std::vector<llama_token> TokenizePrompt(const std::string &prompt) const;
+
+    // Tokenizes texts[begin, end) spread over the given number of threads, a text that can't be tokenized is left empty
+    [[nodiscard]] std::vector<std::vector<llama_token>> TokenizeAll(const std::vector<std::string> &texts, size_t begin, size_t end,
+                                                                    int threads) const;
+    bool EmbedInputs(const std::vector<std::vector<llama_token>> &inputs, float* output);
+
+    // inputs are the tokens of prompts[first], prompts[first + 1] ...
+    void PrintInputs(const std::vector<std::string> &prompts, size_t first, const std::vector<std::vector<llama_token>> &inputs) const;
 
 	static std::vector<std::string> split_lines(const std::string& s, const std::string& separator = "\n");
-    static void batch_add_seq(llama_batch& batch, const std::vector<int32_t>& tokens, llama_seq_id seq_id);
-    static void batch_decode(llama_context* ctx, const llama_batch& batch, float* output, int n_seq, int n_embd, int embd_norm);
+    static void batch_add_seq(llama_batch& batch, const llama_token* tokens, int n_tokens, llama_seq_id seq_id);
+    bool batch_decode(llama_context* ctx, const llama_batch& batch, float* output, int n_seq, int n_embd, int embd_norm) const;
 };
\ No newline at end of file
@@ -8,7 +8,9 @@
 enum EventNumbers
 {
     LLMPredictedTokenReceived = 1,
-    LLMPredictionComplete =2
+    LLMPredictionComplete =2,
+    RoomWallsChanged = 3,
+    NpcRoomsChanged = 4
 };
 
 #endif //GAME3_EVENTNUMBERS_H
\ No newline at end of file
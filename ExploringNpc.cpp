@@ -150,6 +150,11 @@ std::shared_ptr<MoveProbabilityMatrix> ExploringNpc::GetProbabilityMatrix() cons
 	return moveProbabilityMatrix;
 }
 
+NpcRandom& ExploringNpc::GetRandom()
+{
+	return random;
+}
+
 std::shared_ptr<gamelib::IGameObjectMoveStrategy> ExploringNpc::GetGameObjectMoveStrategy()
 {
 	return gameObjectMoveStrategy;
@@ -25,10 +25,12 @@ public:
 		const bool visible,
 		const AnimatedSpriteSPtr& sprite,
 		std::shared_ptr<MoveProbabilityMatrix> moveProbabilityMatrix, 
-		const std::shared_ptr<mazer::Room>& initialRoom)
+		const std::shared_ptr<mazer::Room>& initialRoom,
+		const uint64_t seed)
 		: Npc(name, type, position, visible, sprite),
 		  moveProbabilityMatrix(moveProbabilityMatrix),
-		  currentRoom(initialRoom)
+		  currentRoom(initialRoom),
+		  random(seed)
 	{
 
 		currentRoomInfo = std::make_shared<mazer::RoomInfo>(initialRoom);
@@ -65,6 +67,9 @@ public:
 
 	std::shared_ptr<MoveProbabilityMatrix> GetProbabilityMatrix() const;
 
+	// This NPC's own random numbers for deciding where to go
+	NpcRandom& GetRandom();
+
 	std::shared_ptr<gamelib::IGameObjectMoveStrategy> GetGameObjectMoveStrategy();
 
 	std::shared_ptr<gamelib::Hotspot> GetHotspot() const;
@@ -78,6 +83,7 @@ private:
 	std::shared_ptr<MoveProbabilityMatrix> moveProbabilityMatrix;
 	std::shared_ptr<mazer::Room> currentRoom;
 	std::shared_ptr<mazer::RoomInfo> currentRoomInfo;
+	NpcRandom random;
 	gamelib::BehaviorTree* behaviorTree;
 	std::shared_ptr<mazer::Room> lastRoom;
 	bool isWithinSingleRoom = false;
@@ -0,0 +1,63 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "FlowField.h"
+
+FlowField::FlowField(const RoomGraph& graph)
+    : graph(graph),
+      directions(graph.GetRoomCount(), static_cast<uint8_t>(gamelib::Direction::None)),
+      distances(graph.GetRoomCount(), unreachable)
+{
+    frontier.reserve(graph.GetRoomCount());
+}
+
+void FlowField::SetTarget(const int targetRoom)
+{
+    if (targetRoom == target && !IsStale())
+    {
+        return;
+    }
+
+    target = targetRoom;
+    Search();
+}
+
+void FlowField::Search()
+{
+    const auto roomCount = static_cast<size_t>(graph.GetRoomCount());
+    directions.assign(roomCount, static_cast<uint8_t>(gamelib::Direction::None));
+    distances.assign(roomCount, unreachable);
+    frontier.clear();
+    graphVersion = graph.GetVersion();
+
+    if (target < 0 || target >= graph.GetRoomCount())
+    {
+        return;
+    }
+
+    distances[target] = 0;
+    frontier.push_back(target);
+
+    // Search backwards from the target: a room next to one already reached is one more move away, as long as it can be
+    // left in the direction of that room (walls belong to each room, so a way in isn't always a way back out)
+    for (size_t next = 0; next < frontier.size(); next++)
+    {
+        const int room = frontier[next];
+
+        for (const auto side : { gamelib::Direction::Up, gamelib::Direction::Down, gamelib::Direction::Left, gamelib::Direction::Right })
+        {
+            const int from = graph.GetAdjacent(room, side);
+            const auto back = RoomGraph::Opposite(side);
+
+            if (from == RoomGraph::noRoom || distances[from] != unreachable || graph.GetNeighbour(from, back) != room)
+            {
+                continue;
+            }
+
+            distances[from] = distances[room] + 1;
+            directions[from] = static_cast<uint8_t>(back);
+            frontier.push_back(from);
+        }
+    }
+}
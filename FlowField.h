@@ -0,0 +1,56 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_FLOWFIELD_H
+#define GAME3_FLOWFIELD_H
+
+#include <cstdint>
+#include <vector>
+#include <character/Direction.h>
+
+#include "RoomGraph.h"
+
+/**
+ * The way to go from every room to get to one target room by the fewest moves, worked out with one breadth first
+ * search out from the target. Any number of NPCs heading for the same room then just look their next move up.
+ */
+class FlowField
+{
+public:
+    explicit FlowField(const RoomGraph& graph);
+
+    /**
+     * Points the field at a room, searching the maze again if it was pointing somewhere else or the walls have changed
+     * since. The search reuses the field's memory, so moving the target every frame doesn't allocate.
+     */
+    void SetTarget(int targetRoom);
+
+    // The first move on a shortest way to the target, Direction::None in the target room or if there is no way there
+    [[nodiscard]] gamelib::Direction GetNextDirection(const int roomNumber) const
+    {
+        return static_cast<gamelib::Direction>(directions[roomNumber]);
+    }
+
+    // How many moves away the target is, or unreachable if there is no way there
+    [[nodiscard]] int GetDistance(const int roomNumber) const { return distances[roomNumber]; }
+
+    [[nodiscard]] int GetTarget() const { return target; }
+
+    // True when the walls have changed since the field was worked out
+    [[nodiscard]] bool IsStale() const { return graphVersion != graph.GetVersion(); }
+
+    static constexpr int unreachable = -1;
+
+private:
+    void Search();
+
+    const RoomGraph& graph;
+    int target = RoomGraph::noRoom;
+    uint64_t graphVersion = 0;
+    std::vector<uint8_t> directions; // a gamelib::Direction per room
+    std::vector<int> distances;
+    std::vector<int> frontier; // reused by each search
+};
+
+#endif //GAME3_FLOWFIELD_H
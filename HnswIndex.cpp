@@ -0,0 +1,354 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "HnswIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // Marks which nodes a search has already looked at without clearing a whole array per search
+    struct VisitedList
+    {
+        std::vector<unsigned> marks;
+        unsigned current = 0;
+
+        void Begin(const int size)
+        {
+            if (static_cast<int>(marks.size()) < size)
+            {
+                marks.resize(size, 0);
+            }
+
+            if (++current == 0)
+            {
+                // Wrapped around, start again
+                std::fill(marks.begin(), marks.end(), 0);
+                current = 1;
+            }
+        }
+
+        bool Visit(const int id)
+        {
+            if (marks[id] == current) return false;
+            marks[id] = current;
+            return true;
+        }
+    };
+
+    thread_local VisitedList visitedList;
+
+    bool BetterFirst(const EmbeddingMatch &a, const EmbeddingMatch &b)
+    {
+        return a.score > b.score;
+    }
+
+    bool WorseFirst(const EmbeddingMatch &a, const EmbeddingMatch &b)
+    {
+        return a.score < b.score;
+    }
+}
+
+HnswIndex::HnswIndex(const int n_embd, const HnswParameters parameters)
+    : parameters(parameters),
+      store(n_embd),
+      levelMultiplier(1.0 / std::log(std::max(parameters.M, 2))),
+      randomState(parameters.seed)
+{
+}
+
+template<typename Visitor>
+void HnswIndex::ForEachNeighbour(const int id, const int level, Visitor visit) const
+{
+    // Another thread may be adding links to this node during AddAll
+    std::lock_guard lock(nodeLocks[id]);
+
+    for (const int neighbour : nodes[id].neighbours[level])
+    {
+        visit(neighbour);
+    }
+}
+
+int HnswIndex::Add(const float* embedding)
+{
+    const int id = store.Add(embedding);
+
+    nodes.emplace_back();
+    nodes[id].level = RandomLevel();
+    nodes[id].neighbours.resize(nodes[id].level + 1);
+    nodeLocks.emplace_back();
+
+    Link(id);
+
+    return id;
+}
+
+int HnswIndex::AddAll(const float* embeddings, const int count, int threads)
+{
+    const int first = store.AddAll(embeddings, count);
+
+    // Levels are picked up front, in id order, so the graph doesn't depend on how the threads interleave
+    nodes.resize(first + count);
+    for (int id = first; id < first + count; id++)
+    {
+        nodes[id].level = RandomLevel();
+        nodes[id].neighbours.resize(nodes[id].level + 1);
+        nodeLocks.emplace_back();
+    }
+
+    int next = first;
+
+    // The first node of an empty graph becomes the entry point, everyone else needs something to link to
+    if (entryPoint == -1 && next < first + count)
+    {
+        Link(next++);
+    }
+
+    if (threads <= 0)
+    {
+        threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    threads = std::min(threads, first + count - next);
+
+    std::atomic<int> nextId(next);
+    const auto worker = [&]()
+    {
+        for (int id = nextId++; id < first + count; id = nextId++)
+        {
+            Link(id);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    // This thread helps too
+    worker();
+
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+
+    return first;
+}
+
+std::vector<EmbeddingMatch> HnswIndex::Search(const float* query, const int k) const
+{
+    if (entryPoint == -1 || k <= 0)
+    {
+        return {};
+    }
+
+    const int closest = GreedyClosest(query, entryPoint, maxLevel, 1);
+    auto matches = SearchLayer(query, closest, std::max(parameters.efSearch, k), 0);
+
+    std::sort(matches.begin(), matches.end(), BetterFirst);
+    if (static_cast<int>(matches.size()) > k)
+    {
+        matches.resize(k);
+    }
+
+    return matches;
+}
+
+void HnswIndex::SetEfSearch(const int efSearch)
+{
+    parameters.efSearch = efSearch;
+}
+
+int HnswIndex::RandomLevel()
+{
+    // Exponentially fewer nodes on each level up
+    std::mt19937 random(randomState++);
+    const double uniform = std::uniform_real_distribution<double>(std::numeric_limits<double>::min(), 1.0)(random);
+    return static_cast<int>(-std::log(uniform) * levelMultiplier);
+}
+
+void HnswIndex::Link(const int id)
+{
+    const float* embedding = store.GetEmbedding(id);
+    const int level = nodes[id].level;
+
+    int entry;
+    int topLevel;
+    {
+        std::lock_guard lock(entryLock);
+        if (entryPoint == -1)
+        {
+            entryPoint = id;
+            maxLevel = level;
+            return;
+        }
+        entry = entryPoint;
+        topLevel = maxLevel;
+    }
+
+    // Walk down to the new node's top level, then link it on every level from there to the bottom
+    entry = GreedyClosest(embedding, entry, topLevel, level + 1);
+
+    for (int lc = std::min(level, topLevel); lc >= 0; lc--)
+    {
+        auto candidates = SearchLayer(embedding, entry, parameters.efConstruction, lc);
+        entry = std::max_element(candidates.begin(), candidates.end(), WorseFirst)->id;
+
+        auto selected = SelectNeighbours(std::move(candidates), parameters.M);
+        {
+            std::lock_guard lock(nodeLocks[id]);
+            nodes[id].neighbours[lc] = selected;
+        }
+
+        // Link back from each neighbour, pruning its links if it now has too many
+        const int maxNeighbours = GetMaxNeighbours(lc);
+        for (const int neighbour : selected)
+        {
+            std::lock_guard lock(nodeLocks[neighbour]);
+            auto &links = nodes[neighbour].neighbours[lc];
+
+            if (std::find(links.begin(), links.end(), id) != links.end()) continue;
+
+            links.push_back(id);
+
+            if (static_cast<int>(links.size()) > maxNeighbours)
+            {
+                const float* neighbourEmbedding = store.GetEmbedding(neighbour);
+                std::vector<EmbeddingMatch> linkCandidates;
+                linkCandidates.reserve(links.size());
+                for (const int link : links)
+                {
+                    linkCandidates.push_back({link, store.Score(neighbourEmbedding, link)});
+                }
+                links = SelectNeighbours(std::move(linkCandidates), maxNeighbours);
+            }
+        }
+    }
+
+    if (level > topLevel)
+    {
+        std::lock_guard lock(entryLock);
+        if (level > maxLevel)
+        {
+            entryPoint = id;
+            maxLevel = level;
+        }
+    }
+}
+
+int HnswIndex::GreedyClosest(const float* query, int entry, const int fromLevel, const int toLevel) const
+{
+    float best = store.Score(query, entry);
+
+    for (int level = fromLevel; level >= toLevel; level--)
+    {
+        bool improved = true;
+        while (improved)
+        {
+            improved = false;
+            int closest = entry;
+            ForEachNeighbour(entry, level, [&](const int neighbour)
+            {
+                const float score = store.Score(query, neighbour);
+                if (score > best)
+                {
+                    best = score;
+                    closest = neighbour;
+                    improved = true;
+                }
+            });
+            entry = closest;
+        }
+    }
+
+    return entry;
+}
+
+std::vector<EmbeddingMatch> HnswIndex::SearchLayer(const float* query, const int entry, const int ef, const int level) const
+{
+    auto &visited = visitedList;
+    visited.Begin(static_cast<int>(nodes.size()));
+    visited.Visit(entry);
+
+    const EmbeddingMatch start = {entry, store.Score(query, entry)};
+
+    // candidates to expand, best on top, and the best ef found so far, worst on top
+    std::vector<EmbeddingMatch> candidates = {start};
+    std::vector<EmbeddingMatch> found = {start};
+
+    while (!candidates.empty())
+    {
+        std::pop_heap(candidates.begin(), candidates.end(), WorseFirst);
+        const auto current = candidates.back();
+        candidates.pop_back();
+
+        // Nothing left that could improve on what we have
+        if (current.score < found.front().score && static_cast<int>(found.size()) >= ef)
+        {
+            break;
+        }
+
+        ForEachNeighbour(current.id, level, [&](const int neighbour)
+        {
+            if (!visited.Visit(neighbour)) return;
+
+            const float score = store.Score(query, neighbour);
+
+            if (static_cast<int>(found.size()) < ef || score > found.front().score)
+            {
+                candidates.push_back({neighbour, score});
+                std::push_heap(candidates.begin(), candidates.end(), WorseFirst);
+
+                found.push_back({neighbour, score});
+                std::push_heap(found.begin(), found.end(), BetterFirst);
+
+                if (static_cast<int>(found.size()) > ef)
+                {
+                    std::pop_heap(found.begin(), found.end(), BetterFirst);
+                    found.pop_back();
+                }
+            }
+        });
+    }
+
+    return found;
+}
+
+std::vector<int> HnswIndex::SelectNeighbours(std::vector<EmbeddingMatch> candidates, const int maxNeighbours) const
+{
+    std::sort(candidates.begin(), candidates.end(), BetterFirst);
+
+    // Prefer neighbours in different directions: skip a candidate that is closer to one already picked than to us
+    std::vector<int> selected;
+    selected.reserve(maxNeighbours);
+
+    for (const auto &candidate : candidates)
+    {
+        if (static_cast<int>(selected.size()) >= maxNeighbours) break;
+
+        const float* candidateEmbedding = store.GetEmbedding(candidate.id);
+        const bool diverse = std::none_of(selected.begin(), selected.end(), [&](const int picked)
+        {
+            return store.Score(candidateEmbedding, picked) > candidate.score;
+        });
+
+        if (diverse)
+        {
+            selected.push_back(candidate.id);
+        }
+    }
+
+    return selected;
+}
+
+int HnswIndex::GetMaxNeighbours(const int level) const
+{
+    return level == 0 ? parameters.M * 2 : parameters.M;
+}
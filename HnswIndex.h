@@ -0,0 +1,89 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_HNSWINDEX_H
+#define GAME3_HNSWINDEX_H
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "EmbeddingIndex.h"
+
+struct HnswParameters
+{
+    int M = 16;                // links per node on the upper layers (twice this on the bottom layer)
+    int efConstruction = 200;  // candidates considered when linking a new node, higher builds a better graph slower
+    int efSearch = 64;         // candidates considered per query, higher gives better recall slower
+    unsigned seed = 42;        // for choosing node levels, so the same inserts build the same graph
+};
+
+/**
+ * Approximate nearest neighbour search over embeddings using a Hierarchical Navigable Small World graph.
+ * Queries visit a few hundred vectors rather than all of them, so this stays fast when there are far too many
+ * vectors to search exhaustively with EmbeddingIndex. The vectors themselves are held in an EmbeddingIndex (ids are
+ * shared with it), and the same id order means exact results can be compared against approximate ones.
+ *
+ * Add/AddAll must not be called at the same time as each other or as Search. AddAll uses several threads itself.
+ */
+class HnswIndex
+{
+public:
+    explicit HnswIndex(int n_embd, HnswParameters parameters = {});
+
+    /**
+     * Adds the vector and links it into the graph.
+     * @return the id of the vector, ids count up from 0 in the order vectors are added
+     */
+    int Add(const float* embedding);
+
+    /**
+     * Adds count vectors stored one after the other, linking them into the graph in parallel.
+     * @param threads number of threads to build with, 0 to use all cores
+     * @return the id of the first vector
+     */
+    int AddAll(const float* embeddings, int count, int threads = 0);
+
+    /**
+     * @return up to k approximate best matches, highest score first
+     */
+    [[nodiscard]] std::vector<EmbeddingMatch> Search(const float* query, int k) const;
+
+    void SetEfSearch(int efSearch);
+
+    [[nodiscard]] int Size() const { return store.Size(); }
+    [[nodiscard]] int GetDimensions() const { return store.GetDimensions(); }
+    [[nodiscard]] const HnswParameters &GetParameters() const { return parameters; }
+    [[nodiscard]] int GetMaxLevel() const { return maxLevel; }
+
+    // The vectors, for exact search or scoring
+    [[nodiscard]] const EmbeddingIndex &GetStore() const { return store; }
+
+private:
+    struct Node
+    {
+        int level = 0;
+        std::vector<std::vector<int>> neighbours; // per level, 0 is the bottom
+    };
+
+    int RandomLevel();
+    void Link(int id);
+    [[nodiscard]] int GreedyClosest(const float* query, int entry, int fromLevel, int toLevel) const;
+    [[nodiscard]] std::vector<EmbeddingMatch> SearchLayer(const float* query, int entry, int ef, int level) const;
+    [[nodiscard]] std::vector<int> SelectNeighbours(std::vector<EmbeddingMatch> candidates, int maxNeighbours) const;
+    template<typename Visitor> void ForEachNeighbour(int id, int level, Visitor visit) const;
+    [[nodiscard]] int GetMaxNeighbours(int level) const;
+
+    HnswParameters parameters;
+    EmbeddingIndex store;
+    std::vector<Node> nodes;
+    mutable std::deque<std::mutex> nodeLocks; // one per node, guards its neighbour lists while building
+    std::mutex entryLock; // guards entryPoint and maxLevel while building
+    int entryPoint = -1;
+    int maxLevel = -1;
+    double levelMultiplier;
+    unsigned randomState;
+};
+
+#endif //GAME3_HNSWINDEX_H
@@ -0,0 +1,28 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_INFERENCESTATS_H
+#define GAME3_INFERENCESTATS_H
+
+// How the last prompt went, filled in by the LLMs as they generate
+struct InferenceStats
+{
+    int promptTokens = 0; // evaluated, so not counting any that were reused from the cache or a saved session
+    double promptMs = 0;
+    int generatedTokens = 0;
+    double generationMs = 0;
+    double firstTokenMs = 0; // from starting on the prompt to having the first predicted token
+
+    [[nodiscard]] double PromptTokensPerSecond() const
+    {
+        return promptMs > 0 ? promptTokens * 1000.0 / promptMs : 0;
+    }
+
+    [[nodiscard]] double GenerationTokensPerSecond() const
+    {
+        return generationMs > 0 ? generatedTokens * 1000.0 / generationMs : 0;
+    }
+};
+
+#endif //GAME3_INFERENCESTATS_H
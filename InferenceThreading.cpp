@@ -0,0 +1,201 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "InferenceThreading.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <file/SettingsManager.h>
+
+#include "ggml-cpu.h"
+
+InferenceThreading* InferenceThreading::instance = nullptr;
+
+InferenceThreading* InferenceThreading::Get()
+{
+    if (instance == nullptr) { instance = new InferenceThreading(); }
+    return instance;
+}
+
+void InferenceThreading::LoadSettings()
+{
+    const auto settingsManager = gamelib::SettingsManager::Get();
+
+    cpu_params mask {};
+    const auto reservedCores = settingsManager->GetString("inferenceThreading", "ReservedCores");
+
+    mask.mask_valid = !reservedCores.empty() && MaskOutCores(reservedCores, mask.cpumask);
+    mask.poll = static_cast<uint32_t>(std::clamp(settingsManager->GetInt("inferenceThreading", "Poll"), 0, 100));
+
+    if (!reservedCores.empty() && !mask.mask_valid)
+    {
+        fprintf(stderr, "%s: error: ReservedCores (%s) should look like 0, 0-1 or 0,8\n", __func__, reservedCores.c_str());
+    }
+
+    // By default use a thread for each physical core that isn't reserved. More than that (e.g. one per hyperthread)
+    // only makes the threads fight over the same cores.
+    const auto logicalCores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    const auto physicalCores = std::max(1, cpu_get_num_physical_cores());
+    const auto threadsPerCore = std::max(1, logicalCores / physicalCores);
+    const auto reservedLogical = mask.mask_valid ? logicalCores - static_cast<int>(std::count(std::begin(mask.cpumask), std::end(mask.cpumask), true)) : 0;
+    const auto available = std::max(1, physicalCores - (reservedLogical + threadsPerCore - 1) / threadsPerCore);
+
+    const auto generationThreads = settingsManager->GetInt("inferenceThreading", "GenerationThreads");
+    const auto promptThreads = settingsManager->GetInt("inferenceThreading", "PromptThreads");
+
+    std::lock_guard lock(mutex);
+
+    generation = mask;
+    generation.n_threads = generationThreads > 0 ? generationThreads : available;
+    prompt = mask;
+    prompt.n_threads = promptThreads > 0 ? promptThreads : available;
+    sharedThreadpools = settingsManager->GetBool("inferenceThreading", "SharedThreadpools");
+
+    // New contexts get new threadpools, the old ones are freed along with the last context attached to them
+    generationThreadpool = nullptr;
+    promptThreadpool = nullptr;
+
+    settingsLoaded = true;
+}
+
+void InferenceThreading::LoadSettingsIfNeeded()
+{
+    bool loaded;
+    {
+        std::lock_guard lock(mutex);
+        loaded = settingsLoaded;
+    }
+
+    if (!loaded)
+    {
+        LoadSettings();
+    }
+}
+
+void InferenceThreading::SetThreads(const int generationThreads, const int promptThreads)
+{
+    LoadSettingsIfNeeded();
+
+    std::lock_guard lock(mutex);
+    generation.n_threads = std::max(1, generationThreads);
+    prompt.n_threads = std::max(1, promptThreads);
+
+    // The threadpools are sized when they are made, so new contexts need new ones
+    generationThreadpool = nullptr;
+    promptThreadpool = nullptr;
+}
+
+void InferenceThreading::Apply(llama_context_params &contextParameters)
+{
+    LoadSettingsIfNeeded();
+
+    std::lock_guard lock(mutex);
+    contextParameters.n_threads = generation.n_threads;
+    contextParameters.n_threads_batch = prompt.n_threads;
+}
+
+std::shared_ptr<void> InferenceThreading::Attach(llama_context* context)
+{
+    LoadSettingsIfNeeded();
+
+    std::lock_guard lock(mutex);
+
+    if (!sharedThreadpools || context == nullptr)
+    {
+        return nullptr;
+    }
+
+    auto generationPool = GetThreadpool(generationThreadpool, generation);
+    auto promptPool = GetThreadpool(promptThreadpool, prompt);
+
+    if (generationPool == nullptr || promptPool == nullptr)
+    {
+        return nullptr;
+    }
+
+    llama_attach_threadpool(context, generationPool.get(), promptPool.get());
+
+    // Both pools stay alive for as long as the context might use them
+    return std::make_shared<std::pair<std::shared_ptr<ggml_threadpool>, std::shared_ptr<ggml_threadpool>>>(std::move(generationPool), std::move(promptPool));
+}
+
+std::shared_ptr<ggml_threadpool> InferenceThreading::GetThreadpool(std::shared_ptr<ggml_threadpool> &threadpool, const cpu_params &parameters)
+{
+    if (threadpool == nullptr)
+    {
+        auto threadpoolParameters = ggml_threadpool_params_from_cpu_params(parameters);
+
+        // Making a threadpool moves the thread that makes it onto the pool's cores (and priority), so it is made on a
+        // thread of its own rather than the caller's, which may be the game thread
+        ggml_threadpool* newThreadpool = nullptr;
+        std::thread([&]() { newThreadpool = ggml_threadpool_new(&threadpoolParameters); }).join();
+
+        if (newThreadpool == nullptr)
+        {
+            fprintf(stderr, "%s: error: failed to create a threadpool with %d threads\n", __func__, parameters.n_threads);
+            return nullptr;
+        }
+
+        threadpool = std::shared_ptr<ggml_threadpool>(newThreadpool, ggml_threadpool_free);
+    }
+
+    return threadpool;
+}
+
+int InferenceThreading::GetGenerationThreads()
+{
+    LoadSettingsIfNeeded();
+
+    std::lock_guard lock(mutex);
+    return generation.n_threads;
+}
+
+int InferenceThreading::GetPromptThreads()
+{
+    LoadSettingsIfNeeded();
+
+    std::lock_guard lock(mutex);
+    return prompt.n_threads;
+}
+
+bool InferenceThreading::MaskOutCores(const std::string &cores, bool (&cpuMask)[GGML_MAX_N_THREADS])
+{
+    const auto cpuCount = static_cast<int>(std::min<unsigned>(std::max(1u, std::thread::hardware_concurrency()), GGML_MAX_N_THREADS));
+
+    bool reserved[GGML_MAX_N_THREADS] = {false};
+    std::stringstream list(cores);
+    std::string range;
+
+    while (std::getline(list, range, ','))
+    {
+        try
+        {
+            const auto dash = range.find('-');
+            const auto first = std::stoi(range.substr(0, dash));
+            const auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+            if (first < 0 || last < first || last >= GGML_MAX_N_THREADS)
+            {
+                return false;
+            }
+
+            std::fill(reserved + first, reserved + last + 1, true);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < GGML_MAX_N_THREADS; i++)
+    {
+        cpuMask[i] = i < cpuCount && !reserved[i];
+    }
+
+    // Everything is reserved, which would leave nowhere to run
+    return std::find(cpuMask, cpuMask + GGML_MAX_N_THREADS, true) != cpuMask + GGML_MAX_N_THREADS;
+}
@@ -0,0 +1,71 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_INFERENCETHREADING_H
+#define GAME3_INFERENCETHREADING_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "common.h"
+#include "llama.h"
+
+/**
+ * How many threads inference uses and where they run, read from the "inferenceThreading" settings.
+ *
+ * Prompts (many tokens at once, compute bound) and generation (one token at a time, memory bound) have their own thread
+ * counts. The threads are kept off the cores reserved for the game loop and SDL rendering, and every context shares
+ * the same two threadpools rather than each starting its own threads, so several LLMs never oversubscribe the CPU.
+ */
+class InferenceThreading
+{
+public:
+    static InferenceThreading* Get();
+
+    // Reads the settings, the threadpools are made again (for new contexts) if they have changed
+    void LoadSettings();
+
+    // Overrides the settings' thread counts for contexts made from now on (e.g. to compare thread counts)
+    void SetThreads(int generationThreads, int promptThreads);
+
+    // Sets the context's thread counts
+    void Apply(llama_context_params &contextParameters);
+
+    /**
+     * Runs the context on the shared threadpools, if they are turned on
+     * @return keeps the threadpools alive, hold it until the context has been freed (nullptr if nothing was attached)
+     */
+    std::shared_ptr<void> Attach(llama_context* context);
+
+    [[nodiscard]] int GetGenerationThreads();
+    [[nodiscard]] int GetPromptThreads();
+
+    /**
+     * @param cores e.g. "0", "0-1" or "0,8", the cores that inference threads keep away from
+     * @param cpuMask set to all the other cores
+     * @return false if cores can't be understood
+     */
+    static bool MaskOutCores(const std::string &cores, bool (&cpuMask)[GGML_MAX_N_THREADS]);
+
+private:
+    InferenceThreading() = default;
+
+    void LoadSettingsIfNeeded();
+    static std::shared_ptr<ggml_threadpool> GetThreadpool(std::shared_ptr<ggml_threadpool> &threadpool, const cpu_params &parameters);
+
+    std::mutex mutex;
+    bool settingsLoaded = false;
+    bool sharedThreadpools = true;
+    cpu_params generation {};
+    cpu_params prompt {};
+
+    // Freed once new ones have been made and the last context attached to them has been freed
+    std::shared_ptr<ggml_threadpool> generationThreadpool;
+    std::shared_ptr<ggml_threadpool> promptThreadpool;
+
+    static InferenceThreading* instance;
+};
+
+#endif //GAME3_INFERENCETHREADING_H
@@ -0,0 +1,184 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <file/SettingsManager.h>
+
+JobSystem* JobSystem::instance = nullptr;
+
+JobSystem::JobSystem(const int workerThreads)
+{
+    Start(workerThreads);
+}
+
+JobSystem::~JobSystem()
+{
+    Stop();
+}
+
+JobSystem* JobSystem::Get()
+{
+    if (instance == nullptr) { instance = new JobSystem(); }
+    return instance;
+}
+
+void JobSystem::LoadSettings()
+{
+    auto workerThreads = gamelib::SettingsManager::Get()->GetInt("jobSystem", "WorkerThreads");
+
+    if (workerThreads <= 0)
+    {
+        workerThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) - 1;
+    }
+
+    Stop();
+    Start(workerThreads);
+}
+
+void JobSystem::Start(const int workerThreads)
+{
+    stopping = false;
+
+    queues.clear();
+    queues.push_back(std::make_unique<TaskQueue>());
+
+    for (int worker = 0; worker < workerThreads; worker++)
+    {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    for (int worker = 0; worker < workerThreads; worker++)
+    {
+        workers.emplace_back(&JobSystem::WorkerLoop, this, worker + 1);
+    }
+}
+
+void JobSystem::Stop()
+{
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    workers.clear();
+    queues.resize(1);
+}
+
+void JobSystem::ParallelFor(const int chunkCount, const std::function<void(int chunk)>& job)
+{
+    if (workers.empty() || chunkCount <= 1)
+    {
+        for (int chunk = 0; chunk < chunkCount; chunk++)
+        {
+            job(chunk);
+        }
+        return;
+    }
+
+    std::atomic<int> remaining {chunkCount};
+
+    // Each queue gets a run of chunks next to each other, the caller's included
+    const auto queueCount = static_cast<int>(queues.size());
+    for (int queue = 0; queue < queueCount; queue++)
+    {
+        const int first = chunkCount * queue / queueCount;
+        const int last = chunkCount * (queue + 1) / queueCount;
+
+        std::lock_guard lock(queues[queue]->mutex);
+        for (int chunk = last - 1; chunk >= first; chunk--)
+        {
+            queues[queue]->tasks.push_back({&job, chunk, &remaining});
+        }
+    }
+
+    {
+        std::lock_guard lock(sleepMutex);
+        queuedTasks.fetch_add(chunkCount);
+    }
+    wake.notify_all();
+
+    // Help out until there is nothing left to take, then wait for the chunks still running
+    Task task {};
+    while (TryTake(0, task))
+    {
+        Run(task);
+    }
+
+    std::unique_lock lock(doneMutex);
+    done.wait(lock, [&]() { return remaining.load() == 0; });
+}
+
+void JobSystem::WorkerLoop(const int queueIndex)
+{
+    Task task {};
+
+    while (true)
+    {
+        if (TryTake(queueIndex, task))
+        {
+            Run(task);
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        wake.wait(lock, [&]() { return stopping || queuedTasks.load() > 0; });
+
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+bool JobSystem::TryTake(const int queueIndex, Task& task)
+{
+    const auto queueCount = static_cast<int>(queues.size());
+
+    // Our own queue first (last in, so the chunks are taken in order), then steal from the other end of the others'
+    for (int offset = 0; offset < queueCount; offset++)
+    {
+        auto &queue = *queues[(queueIndex + offset) % queueCount];
+        std::lock_guard lock(queue.mutex);
+
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+
+        if (offset == 0)
+        {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+
+        queuedTasks.fetch_sub(1);
+        return true;
+    }
+
+    return false;
+}
+
+void JobSystem::Run(const Task& task)
+{
+    (*task.job)(task.chunk);
+
+    if (task.remaining->fetch_sub(1) == 1)
+    {
+        std::lock_guard lock(doneMutex);
+        done.notify_all();
+    }
+}
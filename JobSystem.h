@@ -0,0 +1,90 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_JOBSYSTEM_H
+#define GAME3_JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A pool of worker threads that splits a frame's work (e.g. updating thousands of NPCs) across the cores. Work is
+ * handed out as numbered chunks, each thread has its own queue of them and a thread that runs out takes (steals) chunks
+ * from the others, so one slow chunk doesn't hold every other thread up. The thread asking for the work helps out
+ * until it is all done.
+ *
+ * Which thread runs which chunk changes from frame to frame, so anything a chunk produces should go in that chunk's own
+ * buffer and be put together in chunk order afterwards. Then the result is the same however many threads there are.
+ */
+class JobSystem
+{
+public:
+    /**
+     * @param workerThreads threads besides the caller's, none runs everything on the calling thread
+     */
+    explicit JobSystem(int workerThreads = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem& other) = delete;
+    JobSystem& operator=(const JobSystem& other) = delete;
+
+    // Has no worker threads until LoadSettings() is called
+    static JobSystem* Get();
+
+    // Reads "jobSystem"/"WorkerThreads" and (re)starts that many worker threads (0 is one per core besides the game's)
+    void LoadSettings();
+
+    // Finishes the worker threads, jobs then run on the calling thread
+    void Stop();
+
+    /**
+     * Runs job(chunk) for every chunk from 0 to chunkCount - 1 and returns when they have all finished. Call it from
+     * the game thread, not from inside a job.
+     */
+    void ParallelFor(int chunkCount, const std::function<void(int chunk)>& job);
+
+    // The worker threads and the calling thread
+    [[nodiscard]] int GetThreadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+private:
+    struct Task
+    {
+        const std::function<void(int)>* job;
+        int chunk;
+        std::atomic<int>* remaining;
+    };
+
+    // A queue of chunks, its owner takes from the back and thieves from the front
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void Start(int workerThreads);
+    void WorkerLoop(int queueIndex);
+    bool TryTake(int queueIndex, Task& task);
+    void Run(const Task& task);
+
+    std::vector<std::unique_ptr<TaskQueue>> queues; // the caller's is first, then one per worker
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake; // there are tasks to take, or it's time to stop
+    std::atomic<int> queuedTasks {0};
+    bool stopping = false;
+
+    std::mutex doneMutex;
+    std::condition_variable done; // a ParallelFor's last chunk has finished
+
+    static JobSystem* instance;
+};
+
+#endif //GAME3_JOBSYSTEM_H
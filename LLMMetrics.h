@@ -0,0 +1,35 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_LLMMETRICS_H
+#define GAME3_LLMMETRICS_H
+
+#include "MetricsRegistry.h"
+
+// The metrics every LLM records into, looked up once so that recording them per token is cheap
+struct LLMMetrics
+{
+    Histogram &promptEvalMs = MetricsRegistry::Get()->GetHistogram("llm.prompt_eval_ms");
+    Histogram &decodeMs = MetricsRegistry::Get()->GetHistogram("llm.decode_ms"); // one decode, a token or a draft
+    Histogram &sampleMs = MetricsRegistry::Get()->GetHistogram("llm.sample_ms");
+    Histogram &detokenizeMs = MetricsRegistry::Get()->GetHistogram("llm.detokenize_ms");
+    Histogram &firstTokenMs = MetricsRegistry::Get()->GetHistogram("llm.first_token_ms");
+    Histogram &eventDispatchMs = MetricsRegistry::Get()->GetHistogram("llm.event_dispatch_ms");
+
+    Counter &prompts = MetricsRegistry::Get()->GetCounter("llm.prompts");
+    Counter &promptTokens = MetricsRegistry::Get()->GetCounter("llm.prompt_tokens");
+    Counter &generatedTokens = MetricsRegistry::Get()->GetCounter("llm.generated_tokens");
+    Counter &draftedTokens = MetricsRegistry::Get()->GetCounter("llm.drafted_tokens");
+    Counter &acceptedDraftTokens = MetricsRegistry::Get()->GetCounter("llm.accepted_draft_tokens");
+
+    Gauge &generationTokensPerSecond = MetricsRegistry::Get()->GetGauge("llm.generation_tokens_per_s");
+
+    static LLMMetrics& Get()
+    {
+        static LLMMetrics metrics;
+        return metrics;
+    }
+};
+
+#endif //GAME3_LLMMETRICS_H
@@ -0,0 +1,193 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "LLMModelRegistry.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "InferenceThreading.h"
+
+LLMModelRegistry* LLMModelRegistry::instance = nullptr;
+
+LLMModelRegistry* LLMModelRegistry::Get()
+{
+    if (instance == nullptr) { instance = new LLMModelRegistry(); }
+    return instance;
+}
+
+std::shared_ptr<llama_model> LLMModelRegistry::AcquireModel(const std::string &modelPath, const llama_model_params &modelParameters)
+{
+    // load dynamic backends (only needs to happen once per process)
+    std::call_once(backendsLoaded, [] { ggml_backend_load_all(); });
+
+    const auto key = MakeModelKey(modelPath, modelParameters);
+
+    std::lock_guard lock(mutex);
+
+    // Share the model if someone has already loaded it
+    if (const auto existing = models[key].lock())
+    {
+        return existing;
+    }
+
+    llama_model* model = llama_model_load_from_file(modelPath.c_str(), modelParameters);
+
+    if (model == nullptr)
+    {
+        fprintf(stderr, "%s: error: unable to load model %s\n", __func__, modelPath.c_str());
+        models.erase(key);
+        return nullptr;
+    }
+
+    std::shared_ptr<llama_model> sharedModel(model, llama_model_free);
+
+    models[key] = sharedModel;
+
+    return sharedModel;
+}
+
+std::shared_ptr<llama_context> LLMModelRegistry::AcquireContext(const std::shared_ptr<llama_model> &model, const llama_context_params &requestedParameters)
+{
+    if (model == nullptr) return nullptr;
+
+    // Every context follows the same threading policy, whatever its user asked for
+    auto contextParameters = requestedParameters;
+    InferenceThreading::Get()->Apply(contextParameters);
+
+    {
+        std::lock_guard lock(mutex);
+
+        // Find the smallest idle context that can do the job
+        auto best = idleContexts.end();
+        for (auto it = idleContexts.begin(); it != idleContexts.end(); ++it)
+        {
+            if (it->model != model || !IsCompatible(it->contextParameters, contextParameters)) continue;
+
+            if (best == idleContexts.end() || it->contextParameters.n_ctx < best->contextParameters.n_ctx)
+            {
+                best = it;
+            }
+        }
+
+        if (best != idleContexts.end())
+        {
+            const auto pooledContext = *best;
+            idleContexts.erase(best);
+            return Wrap(pooledContext);
+        }
+    }
+
+    // Nothing suitable in the pool, so make a new one
+    llama_context* context = llama_init_from_model(model.get(), contextParameters);
+
+    if (context == nullptr)
+    {
+        fprintf(stderr, "%s: error: failed to create the llama_context\n", __func__);
+        return nullptr;
+    }
+
+    auto threadpools = InferenceThreading::Get()->Attach(context);
+
+    return Wrap({model, context, contextParameters, std::move(threadpools)});
+}
+
+std::shared_ptr<llama_context> LLMModelRegistry::Wrap(const PooledContext &pooledContext)
+{
+    // When the last user lets go of the context, it goes back into the pool rather than being freed
+    return {pooledContext.context, [this, pooledContext](llama_context*)
+    {
+        CheckIn(pooledContext);
+    }};
+}
+
+void LLMModelRegistry::CheckIn(const PooledContext &pooledContext)
+{
+    // Forget anything the previous user left in the context
+    llama_memory_clear(llama_get_memory(pooledContext.context), true);
+    llama_set_abort_callback(pooledContext.context, nullptr, nullptr);
+
+    std::vector<PooledContext> evicted;
+    {
+        std::lock_guard lock(mutex);
+
+        idleContexts.push_back(pooledContext);
+
+        // Free the oldest idle contexts if we're holding on to too many
+        while (idleContexts.size() > maxIdleContexts)
+        {
+            evicted.push_back(idleContexts.front());
+            idleContexts.erase(idleContexts.begin());
+        }
+    }
+
+    for (const auto &context : evicted)
+    {
+        llama_free(context.context);
+    }
+}
+
+void LLMModelRegistry::ReleaseIdleContexts()
+{
+    std::vector<PooledContext> released;
+    {
+        std::lock_guard lock(mutex);
+        released.swap(idleContexts);
+    }
+
+    // Freeing the contexts also drops their references to the models
+    for (const auto &context : released)
+    {
+        llama_free(context.context);
+    }
+}
+
+void LLMModelRegistry::SetMaxIdleContexts(const size_t maxContexts)
+{
+    std::lock_guard lock(mutex);
+    maxIdleContexts = maxContexts;
+}
+
+size_t LLMModelRegistry::CountLoadedModels()
+{
+    std::lock_guard lock(mutex);
+    return std::count_if(models.begin(), models.end(), [](const auto &entry) { return !entry.second.expired(); });
+}
+
+size_t LLMModelRegistry::CountIdleContexts()
+{
+    std::lock_guard lock(mutex);
+    return idleContexts.size();
+}
+
+std::string LLMModelRegistry::MakeModelKey(const std::string &modelPath, const llama_model_params &modelParameters)
+{
+    std::stringstream key;
+    key << modelPath
+        << "|ngl=" << modelParameters.n_gpu_layers
+        << "|split=" << modelParameters.split_mode
+        << "|gpu=" << modelParameters.main_gpu
+        << "|vocab_only=" << modelParameters.vocab_only
+        << "|mmap=" << modelParameters.use_mmap
+        << "|mlock=" << modelParameters.use_mlock;
+    return key.str();
+}
+
+bool LLMModelRegistry::IsCompatible(const llama_context_params &pooled, const llama_context_params &requested)
+{
+    // Bigger is fine for sizes, everything else has to match exactly
+    return pooled.n_ctx >= requested.n_ctx &&
+           pooled.n_batch >= requested.n_batch &&
+           pooled.n_ubatch == requested.n_ubatch &&
+           pooled.n_seq_max == requested.n_seq_max &&
+           pooled.n_threads == requested.n_threads &&
+           pooled.n_threads_batch == requested.n_threads_batch &&
+           pooled.pooling_type == requested.pooling_type &&
+           pooled.attention_type == requested.attention_type &&
+           pooled.embeddings == requested.embeddings &&
+           pooled.kv_unified == requested.kv_unified &&
+           pooled.type_k == requested.type_k &&
+           pooled.type_v == requested.type_v;
+}
@@ -0,0 +1,80 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_LLMMODELREGISTRY_H
+#define GAME3_LLMMODELREGISTRY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "llama.h"
+
+/**
+ * Process-wide registry of loaded models and a pool of reusable contexts.
+ *
+ * Models are keyed by their path and load parameters and are reference counted, so SimpleLLM, StreamingLLM and
+ * EmbeddingLLM share the same weights in memory when they use the same GGUF file. A model is freed once the last
+ * user (including any pooled context) lets go of it.
+ *
+ * Contexts are checked out with AcquireContext and automatically checked back into the pool when the last
+ * reference to them is released. Pooled contexts have their memory (KV cache) cleared before they are reused.
+ */
+class LLMModelRegistry
+{
+public:
+    static LLMModelRegistry* Get();
+
+    /**
+     * @param modelPath path to the model gguf file
+     * @param modelParameters parameters used to load the model, part of the key used to share models
+     * @return the loaded model or nullptr if it could not be loaded
+     */
+    std::shared_ptr<llama_model> AcquireModel(const std::string &modelPath, const llama_model_params &modelParameters);
+
+    /**
+     * Checks out an idle context that is compatible with the requested parameters or creates a new one.
+     * A compatible context has at least the requested context and batch sizes and otherwise matches. Thread counts
+     * come from InferenceThreading rather than the requested parameters.
+     * @return the context or nullptr if it could not be created
+     */
+    std::shared_ptr<llama_context> AcquireContext(const std::shared_ptr<llama_model> &model, const llama_context_params &requestedParameters);
+
+    // Frees all contexts that are not currently checked out
+    void ReleaseIdleContexts();
+
+    // Sets how many idle contexts are kept around for reuse before the oldest are freed
+    void SetMaxIdleContexts(size_t maxContexts);
+
+    size_t CountLoadedModels();
+    size_t CountIdleContexts();
+
+private:
+    LLMModelRegistry() = default;
+
+    struct PooledContext
+    {
+        std::shared_ptr<llama_model> model; // keeps the model alive while the context is pooled
+        llama_context* context;
+        llama_context_params contextParameters;
+        std::shared_ptr<void> threadpools; // the shared threadpools the context runs on, released after it is freed
+    };
+
+    static std::string MakeModelKey(const std::string &modelPath, const llama_model_params &modelParameters);
+    static bool IsCompatible(const llama_context_params &pooled, const llama_context_params &requested);
+    std::shared_ptr<llama_context> Wrap(const PooledContext &pooledContext);
+    void CheckIn(const PooledContext &pooledContext);
+
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<llama_model>> models;
+    std::vector<PooledContext> idleContexts;
+    size_t maxIdleContexts = 4;
+    std::once_flag backendsLoaded;
+
+    static LLMModelRegistry* instance;
+};
+
+#endif //GAME3_LLMMODELREGISTRY_H
@@ -0,0 +1,57 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_LLMPREDICTEDTOKENEVENTPOOL_H
+#define GAME3_LLMPREDICTEDTOKENEVENTPOOL_H
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "LLMTokenPredictedReceived.h"
+
+/**
+ * Reuses LLMPredictedTokenReceivedEvents rather than making a new one for every token. An event can be reused once the
+ * event manager has finished with it (we hold the only reference), and its token keeps its capacity, so raising token
+ * events stops allocating once the pool has warmed up. Use from the game thread only.
+ */
+class LLMPredictedTokenEventPool
+{
+public:
+    explicit LLMPredictedTokenEventPool(const size_t initialSize = 64)
+    {
+        events.reserve(initialSize);
+        for (size_t i = 0; i < initialSize; i++)
+        {
+            events.push_back(std::make_shared<LLMPredictedTokenReceivedEvent>(std::string()));
+        }
+    }
+
+    std::shared_ptr<LLMPredictedTokenReceivedEvent> Acquire(const std::string_view token)
+    {
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            auto &event = events[(next + i) % events.size()];
+
+            if (event.use_count() == 1)
+            {
+                next = (next + i + 1) % events.size();
+                event->token.assign(token);
+                return event;
+            }
+        }
+
+        // Everything is still in use, the pool has to grow
+        events.push_back(std::make_shared<LLMPredictedTokenReceivedEvent>(std::string(token)));
+        return events.back();
+    }
+
+    [[nodiscard]] size_t Size() const { return events.size(); }
+
+private:
+    std::vector<std::shared_ptr<LLMPredictedTokenReceivedEvent>> events;
+    size_t next = 0;
+};
+
+#endif //GAME3_LLMPREDICTEDTOKENEVENTPOOL_H
@@ -0,0 +1,156 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "LLMRequestQueue.h"
+
+#include <algorithm>
+
+LLMRequestQueue::LLMRequestQueue(std::shared_ptr<BatchedLLM> llm, const int maxConcurrentSequences,
+                                 const size_t maxQueuedRequests, const LLMQueueOverflowPolicy overflowPolicy)
+    : llm(std::move(llm)),
+      maxConcurrentSequences(maxConcurrentSequences),
+      maxQueuedRequests(maxQueuedRequests),
+      overflowPolicy(overflowPolicy)
+{
+}
+
+int LLMRequestQueue::Enqueue(LLMRequest request)
+{
+    if (queue.size() >= maxQueuedRequests)
+    {
+        switch (overflowPolicy)
+        {
+            case LLMQueueOverflowPolicy::RejectNew:
+                if (request.onDropped) request.onDropped();
+                return -1;
+
+            case LLMQueueOverflowPolicy::DropOldest:
+                if (queue.empty())
+                {
+                    if (request.onDropped) request.onDropped();
+                    return -1;
+                }
+                Drop(queue.begin());
+                break;
+
+            case LLMQueueOverflowPolicy::DropLowestPriority:
+            {
+                // Of the lowest priority requests, drop the newest as it has waited the least
+                const auto lowest = std::min_element(queue.rbegin(), queue.rend(), [](const QueuedRequest &a, const QueuedRequest &b)
+                {
+                    return a.request.priority < b.request.priority;
+                });
+
+                if (lowest == queue.rend() || lowest->request.priority >= request.priority)
+                {
+                    if (request.onDropped) request.onDropped();
+                    return -1;
+                }
+
+                Drop(std::next(lowest).base());
+                break;
+            }
+        }
+    }
+
+    const auto ticket = nextTicket++;
+    queue.push_back({ticket, std::move(request)});
+    return ticket;
+}
+
+int LLMRequestQueue::Update()
+{
+    // New requests join the batch that is already in flight
+    Admit();
+
+    return llm->Step();
+}
+
+void LLMRequestQueue::Admit()
+{
+    while (!queue.empty() && static_cast<int>(inFlight.size()) < maxConcurrentSequences && llm->HasFreeSequence())
+    {
+        // Highest priority first, oldest first for equal priorities
+        const auto next = std::max_element(queue.begin(), queue.end(), [](const QueuedRequest &a, const QueuedRequest &b)
+        {
+            return a.request.priority < b.request.priority;
+        });
+
+        auto [ticket, request] = std::move(*next);
+        queue.erase(next);
+
+        auto onToken = request.onToken;
+        auto onComplete = request.onComplete;
+
+        const auto requestId = llm->Submit(request.prompt, request.n_predict,
+            [onToken](int, const std::string &token)
+            {
+                if (onToken) onToken(token);
+            },
+            [this, ticket, onComplete](int, const std::string &response)
+            {
+                // The sequence is free again as of now
+                inFlight.erase(ticket);
+                if (onComplete) onComplete(response);
+            });
+
+        if (requestId == -1)
+        {
+            // It could not be placed (e.g. the prompt is too long for a sequence)
+            if (request.onDropped) request.onDropped();
+            continue;
+        }
+
+        inFlight[ticket] = requestId;
+    }
+}
+
+bool LLMRequestQueue::Cancel(const int ticket)
+{
+    const auto queued = std::find_if(queue.begin(), queue.end(), [ticket](const QueuedRequest &q)
+    {
+        return q.ticket == ticket;
+    });
+
+    if (queued != queue.end())
+    {
+        Drop(queued);
+        return true;
+    }
+
+    const auto running = inFlight.find(ticket);
+
+    if (running != inFlight.end())
+    {
+        // This completes the request, which takes it out of inFlight
+        llm->Cancel(running->second);
+        return true;
+    }
+
+    return false;
+}
+
+void LLMRequestQueue::Drop(const std::deque<QueuedRequest>::iterator queued)
+{
+    const auto onDropped = queued->request.onDropped;
+
+    queue.erase(queued);
+
+    if (onDropped) onDropped();
+}
+
+size_t LLMRequestQueue::CountQueued() const
+{
+    return queue.size();
+}
+
+int LLMRequestQueue::CountInFlight() const
+{
+    return static_cast<int>(inFlight.size());
+}
+
+bool LLMRequestQueue::IsIdle() const
+{
+    return queue.empty() && inFlight.empty();
+}
@@ -0,0 +1,83 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_LLMREQUESTQUEUE_H
+#define GAME3_LLMREQUESTQUEUE_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "BatchedLLM.h"
+
+// What to do when a request arrives and the queue is already full
+enum class LLMQueueOverflowPolicy
+{
+    RejectNew,          // Turn the new request away
+    DropOldest,         // Make room by dropping the request that has been waiting the longest
+    DropLowestPriority  // Make room by dropping the lowest priority request (unless the new one is lower still)
+};
+
+struct LLMRequest
+{
+    std::string prompt;
+    int n_predict = 32;
+    int priority = 0; // higher priority requests are admitted first
+    std::function<void(const std::string &token)> onToken;
+    std::function<void(const std::string &response)> onComplete;
+    std::function<void()> onDropped; // called if the request is rejected or dropped before it started
+};
+
+/**
+ * Sits in front of a BatchedLLM and feeds it requests, continuous batching style: queued requests join the in-flight
+ * batch at the next decode step as soon as a sequence is free, and a finished sequence frees its slot immediately.
+ * The number of in-flight sequences and waiting requests are both bounded, so a burst of requests degrades by
+ * dropping work according to the overflow policy rather than building up unbounded latency.
+ *
+ * Call Update() regularly (e.g. once per frame or from a worker thread), each call admits what it can and then
+ * decodes one step.
+ */
+class LLMRequestQueue
+{
+public:
+    LLMRequestQueue(std::shared_ptr<BatchedLLM> llm, int maxConcurrentSequences, size_t maxQueuedRequests,
+                    LLMQueueOverflowPolicy overflowPolicy = LLMQueueOverflowPolicy::RejectNew);
+
+    /**
+     * @return a ticket identifying the request or -1 if it was rejected
+     */
+    int Enqueue(LLMRequest request);
+
+    // Admits waiting requests into free sequences and decodes one step. Returns the number of tokens decoded.
+    int Update();
+
+    // Removes a waiting request or stops an in-flight one. Returns false if the ticket is unknown or already done.
+    bool Cancel(int ticket);
+
+    [[nodiscard]] size_t CountQueued() const;
+    [[nodiscard]] int CountInFlight() const;
+    [[nodiscard]] bool IsIdle() const;
+
+private:
+    struct QueuedRequest
+    {
+        int ticket;
+        LLMRequest request;
+    };
+
+    void Admit();
+    void Drop(std::deque<QueuedRequest>::iterator queued);
+
+    std::shared_ptr<BatchedLLM> llm;
+    int maxConcurrentSequences;
+    size_t maxQueuedRequests;
+    LLMQueueOverflowPolicy overflowPolicy;
+    std::deque<QueuedRequest> queue; // oldest first
+    std::map<int, int> inFlight; // ticket -> BatchedLLM request id
+    int nextTicket = 0;
+};
+
+#endif //GAME3_LLMREQUESTQUEUE_H
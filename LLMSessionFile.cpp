@@ -0,0 +1,202 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "LLMSessionFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "ContentHash.h"
+
+namespace
+{
+    constexpr char magic[8] = { 'G', '3', 'S', 'E', 'S', 'S', 'N', '\0' };
+}
+
+struct LLMSessionFile::Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t tokenSize; // sizeof(llama_token), so a file from a different build isn't misread
+    uint64_t modelHash;
+    uint64_t tokenCount;
+    uint64_t stateSize;
+};
+
+bool LLMSessionFile::Save(const std::string &path, llama_context* ctx, const llama_seq_id seq, const uint64_t modelHash,
+                          const std::vector<llama_token> &tokens)
+{
+    const auto stateSize = llama_state_seq_get_size(ctx, seq);
+
+    if (tokens.empty() || stateSize == 0)
+    {
+        return false;
+    }
+
+    // Everything goes into one buffer so that it is a single write (and the file is read back in one go)
+    const auto tokensSize = tokens.size() * sizeof(llama_token);
+    std::vector<uint8_t> buffer(sizeof(Header) + tokensSize + stateSize);
+
+    Header header {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.tokenSize = sizeof(llama_token);
+    header.modelHash = modelHash;
+    header.tokenCount = tokens.size();
+    header.stateSize = llama_state_seq_get_data(ctx, buffer.data() + sizeof(Header) + tokensSize, stateSize, seq);
+
+    if (header.stateSize == 0)
+    {
+        fprintf(stderr, "%s: error: failed to copy the sequence state\n", __func__);
+        return false;
+    }
+
+    std::memcpy(buffer.data(), &header, sizeof(Header));
+    std::memcpy(buffer.data() + sizeof(Header), tokens.data(), tokensSize);
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    // Written under another name first, so that a crash part way through never leaves a broken session behind
+    const auto temporaryPath = path + ".tmp";
+    FILE* file = fopen(temporaryPath.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        fprintf(stderr, "%s: error: unable to create %s\n", __func__, temporaryPath.c_str());
+        return false;
+    }
+
+    const auto size = sizeof(Header) + tokensSize + header.stateSize;
+    const bool written = fwrite(buffer.data(), 1, size, file) == size;
+    fclose(file);
+
+    if (!written)
+    {
+        fprintf(stderr, "%s: error: unable to write %s\n", __func__, temporaryPath.c_str());
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+
+    return !error;
+}
+
+size_t LLMSessionFile::Restore(const std::string &path, llama_context* ctx, const llama_seq_id seq, const uint64_t modelHash,
+                               const std::vector<llama_token> &promptTokens)
+{
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(path, error);
+
+    if (error || fileSize < sizeof(Header))
+    {
+        return 0;
+    }
+
+    FILE* file = fopen(path.c_str(), "rb");
+
+    if (file == nullptr)
+    {
+        return 0;
+    }
+
+    std::vector<uint8_t> buffer(fileSize);
+    const bool read = fread(buffer.data(), 1, fileSize, file) == fileSize;
+    fclose(file);
+
+    Header header {};
+    std::memcpy(&header, buffer.data(), sizeof(Header));
+
+    const auto tokensSize = header.tokenCount * sizeof(llama_token);
+
+    if (!read || std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+        header.tokenSize != sizeof(llama_token) || header.modelHash != modelHash ||
+        header.tokenCount == 0 || header.tokenCount > promptTokens.size() ||
+        sizeof(Header) + tokensSize + header.stateSize != fileSize)
+    {
+        return 0;
+    }
+
+    // The saved tokens have to be the start of this prompt, otherwise the state is for something else
+    if (std::memcmp(buffer.data() + sizeof(Header), promptTokens.data(), tokensSize) != 0)
+    {
+        return 0;
+    }
+
+    if (llama_state_seq_set_data(ctx, buffer.data() + sizeof(Header) + tokensSize, header.stateSize, seq) == 0)
+    {
+        // e.g. the context is too small for it
+        fprintf(stderr, "%s: error: failed to restore the sequence state from %s\n", __func__, path.c_str());
+        return 0;
+    }
+
+    // Sessions that are still being used are the last to be trimmed
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    return header.tokenCount;
+}
+
+std::string LLMSessionFile::PathFor(const std::string &directory, const uint64_t modelHash, const std::vector<llama_token> &tokens)
+{
+    auto hash = ContentHash(std::string_view(reinterpret_cast<const char*>(&modelHash), sizeof(modelHash)));
+    hash = ContentHash(std::string_view(reinterpret_cast<const char*>(tokens.data()), tokens.size() * sizeof(llama_token)), hash);
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.session", static_cast<unsigned long long>(hash));
+
+    return (std::filesystem::path(directory) / name).string();
+}
+
+void LLMSessionFile::Trim(const std::string &directory, const uint64_t maxBytes, const std::string &keep)
+{
+    struct Session
+    {
+        std::filesystem::path path;
+        std::filesystem::file_time_type used;
+        uint64_t size;
+    };
+
+    std::vector<Session> sessions;
+    uint64_t totalBytes = 0;
+    std::error_code error;
+
+    for (auto entry = std::filesystem::directory_iterator(directory, error);
+         !error && entry != std::filesystem::directory_iterator(); entry.increment(error))
+    {
+        if (entry->path().extension() != ".session")
+        {
+            continue;
+        }
+
+        std::error_code fileError;
+        const auto size = entry->file_size(fileError);
+        const auto used = entry->last_write_time(fileError);
+
+        if (!fileError)
+        {
+            sessions.push_back({entry->path(), used, size});
+            totalBytes += size;
+        }
+    }
+
+    // Least recently used first
+    std::sort(sessions.begin(), sessions.end(), [](const Session &a, const Session &b) { return a.used < b.used; });
+
+    const std::filesystem::path keepPath(keep);
+    for (const auto &session : sessions)
+    {
+        if (totalBytes <= maxBytes)
+        {
+            break;
+        }
+
+        if (session.path != keepPath && std::filesystem::remove(session.path, error))
+        {
+            totalBytes -= session.size;
+        }
+    }
+}
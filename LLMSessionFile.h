@@ -0,0 +1,59 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_LLMSESSIONFILE_H
+#define GAME3_LLMSESSIONFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "llama.h"
+
+/**
+ * Saves the evaluated state (KV cache) of a prompt so that the next run, or the next level, can restore it instead of
+ * evaluating the prompt all over again.
+ *
+ * Layout: a header (magic, version, the model hash, token and state sizes), the prompt tokens, then the sequence state
+ * exactly as llama_state_seq_get_data() gave it. Restoring is one read of the whole file.
+ *
+ * A file is only used if it was made with the same model and its tokens are the start of the prompt being evaluated.
+ */
+class LLMSessionFile
+{
+public:
+    /**
+     * @param tokens the tokens whose state is in the sequence
+     * @return false if the file could not be written
+     */
+    static bool Save(const std::string &path, llama_context* ctx, llama_seq_id seq, uint64_t modelHash,
+                     const std::vector<llama_token> &tokens);
+
+    /**
+     * Puts the saved state into the (empty) sequence if it belongs to the model and prompt.
+     * @return how many of the prompt's tokens were restored, 0 if the file is missing or doesn't match
+     */
+    static size_t Restore(const std::string &path, llama_context* ctx, llama_seq_id seq, uint64_t modelHash,
+                          const std::vector<llama_token> &promptTokens);
+
+    // Where the state of this prompt is kept in the directory, named after the model and the prompt
+    static std::string PathFor(const std::string &directory, uint64_t modelHash, const std::vector<llama_token> &tokens);
+
+    /**
+     * Deletes the sessions in the directory that were saved or restored longest ago until the rest fit in maxBytes,
+     * nothing else ever deletes them
+     * @param keep a session that stays whatever its size, e.g. the one just saved
+     */
+    static void Trim(const std::string &directory, uint64_t maxBytes, const std::string &keep = "");
+
+    static constexpr uint32_t version = 1;
+
+    // How much a session directory holds unless told otherwise ("llm"/"MaxSessionMb")
+    static constexpr uint64_t defaultMaxDirectoryBytes = 256ull * 1024 * 1024;
+
+private:
+    struct Header;
+};
+
+#endif //GAME3_LLMSESSIONFILE_H
@@ -33,7 +33,9 @@
 #include <random>
 
 #include "ExploringNpc.h"
+#include "JobSystem.h"
 #include "MoveProbabilityMatrix.h"
+#include "RoomWallsChangedEvent.h"
 
 using namespace gamelib;
 using namespace mazer;
@@ -78,6 +80,7 @@ bool LevelManager::Initialize()
 	eventManager->SubscribeToEvent(PlayerCollidedWithEnemyEventId, this);
 	eventManager->SubscribeToEvent(PlayerDiedEventId, this);
 	eventManager->SubscribeToEvent(PlayerCollidedWithPickupEventId, this);
+	eventManager->SubscribeToEvent(RoomWallsChangedEventId, this);
 
 	elapsedTimeProvider = std::make_shared<ElapsedGameTimeProvider>();
 
@@ -116,6 +119,9 @@ ListOfEvents LevelManager::HandleEvent(const std::shared_ptr<Event>& evt, const
 
 	// Respond to player dying
 	if(evt->Id.PrimaryId == PlayerDiedEventId.PrimaryId) { OnPlayerDied(); }
+
+	// Respond to walls moving
+	if(evt->Id.PrimaryId == RoomWallsChangedEventId.PrimaryId) { OnRoomWallsChanged(evt); }
 		
 	return {};
 }
@@ -189,6 +195,18 @@ void LevelManager::OnPlayerDied()
 	Logger::Get()->LogThis("Player DIED!");
 }
 
+void LevelManager::OnRoomWallsChanged(const std::shared_ptr<Event>& evt) const
+{
+	if (moveProbabilityMatrix == nullptr) return;
+
+	// Only the rooms whose walls moved need their move probabilities and neighbours working out again
+	for (const auto& room : To<RoomWallsChangedEvent>(evt)->Rooms)
+	{
+		moveProbabilityMatrix->Update(*room);
+		navigation->Update(*room);
+	}
+}
+
 void LevelManager::OnStartNetworkLevel(const std::shared_ptr<Event>& evt)
 {
 	// Always start the game on level 1 when the network game starts
@@ -395,12 +413,40 @@ void LevelManager::CreateExploringNpc(const std::vector<std::shared_ptr<mazer::R
 
 	// Create an ExploringNPC and set its position to the center of the room
 	auto centerOfRoom = rooms[targetRoomNumber]->GetCenter(animatedSprite->Dimensions);
-	exploringNpc = std::make_shared<ExploringNpc>("john", "Wanderer", centerOfRoom, true, animatedSprite, moveProbabilityMatrix, rooms[targetRoomNumber]);
+	// The same seed wanders the same way every run
+	const auto seed = static_cast<uint64_t>(GetIntSetting("WanderingNPC", "seed"));
+	exploringNpc = std::make_shared<ExploringNpc>("john", "Wanderer", centerOfRoom, true, animatedSprite, moveProbabilityMatrix, rooms[targetRoomNumber], seed);
 	exploringNpc->Initialize();
 
 	AddGameObjectToScene(exploringNpc);
 }
 
+void LevelManager::CreateNpcCrowd(const std::vector<std::shared_ptr<mazer::Room>>& rooms)
+{
+	const auto crowdSize = GetIntSetting("WanderingNPC", "crowdSize");
+	if (crowdSize <= 0 || rooms.empty()) return;
+
+	// Every room is the same size, laid out from the top left one
+	const auto& firstRoom = rooms.front();
+	const RoomLayout layout { static_cast<float>(firstRoom->GetX()), static_cast<float>(firstRoom->GetY()),
+		static_cast<float>(firstRoom->GetWidth()), static_cast<float>(firstRoom->GetHeight()), level->NumCols };
+
+	// The crowd wanders the same way the exploring NPC does, but is updated as one rather than an NPC at a time
+	const auto simulation = std::make_shared<NpcSimulation>(moveProbabilityMatrix, navigation, layout);
+	for (int npc = 0; npc < crowdSize; npc++)
+	{
+		simulation->Add(static_cast<int>(GetRandomIndex(0, static_cast<int>(rooms.size()) - 1)), npc);
+	}
+
+	// Only a crowd needs worker threads ("jobSystem"/"WorkerThreads"), they are started here rather than up front
+	JobSystem::Get()->LoadSettings();
+
+	npcCrowd = std::make_shared<NpcCrowd>(simulation);
+	npcCrowd->LoadSettings();
+
+	AddGameObjectToScene(npcCrowd);
+}
+
 void LevelManager::CreateLevel(const string& levelFilePath)
 {	
 	RemoveAllGameObjects();
@@ -432,6 +478,7 @@ void LevelManager::CreateLevel(const string& levelFilePath)
 
 	// Create our exploring NPCs
 	CreateExploringNpc(rooms);
+	CreateNpcCrowd(rooms);
 }
 
 std::shared_ptr<DrawableFrameRate> LevelManager::CreateDrawableFrameRate()
@@ -556,6 +603,9 @@ void LevelManager::InitializeRooms(const std::vector<std::shared_ptr<mazer::Room
 
 	// Based on the rooms created, build a move probability matrix that defines the rules of allowed movements
 	moveProbabilityMatrix = std::make_shared<MoveProbabilityMatrix>(level->Rooms);
+
+	// And the graph of which rooms lead to which, for NPCs that want to get somewhere
+	navigation = std::make_shared<Navigation>(RoomGraph(level->Rooms, level->NumCols));
 }
 
 
@@ -19,7 +19,9 @@
 #include "Level.h"
 #include <vector>
 #include "MoveProbabilityMatrix.h"
+#include "Navigation.h"
 #include "ExploringNpc.h"
+#include "NpcCrowd.h"
 
 typedef std::vector<std::weak_ptr<gamelib::GameObject>> ListOfGameObjects;
 
@@ -50,6 +52,7 @@ public:
     static void PlayLevelMusic(const std::string& levelMusicAssetName);
     std::shared_ptr<InputManager> GetInputManager();
     std::shared_ptr<mazer::Level> GetLevel();
+    std::shared_ptr<Navigation> GetNavigation() const { return navigation; }
     std::string GetSubscriberName() override;
     void CreateAutoLevel(); // Raises level creation events
     std::shared_ptr<gamelib::DrawableFrameRate> CreateDrawableFrameRate();
@@ -95,6 +98,7 @@ private:
 
     void AddScreenWidgets(const std::vector<std::shared_ptr<mazer::Room>>& rooms);
     void CreateExploringNpc(const std::vector<std::shared_ptr<mazer::Room>>& rooms);
+    void CreateNpcCrowd(const std::vector<std::shared_ptr<mazer::Room>>& rooms);
     void CreateAutoPickups(const std::vector<std::shared_ptr<mazer::Room>>& rooms);
     void CreatePlayer(const std::vector<std::shared_ptr<mazer::Room>>& rooms, int resourceId);
     void OnGameWon();
@@ -105,10 +109,13 @@ private:
     static void OnNetworkPlayerJoined(const std::shared_ptr<gamelib::Event>& evt);
     void OnPickupCollision(const std::shared_ptr<gamelib::Event>& evt) const;
     void OnStartNetworkLevel(const std::shared_ptr<gamelib::Event>& evt);
+    void OnRoomWallsChanged(const std::shared_ptr<gamelib::Event>& evt) const;
 
     std::shared_ptr<gamelib::IElapsedTimeProvider> elapsedTimeProvider;
 	std::shared_ptr<MoveProbabilityMatrix> moveProbabilityMatrix;
+	std::shared_ptr<Navigation> navigation;
 	std::shared_ptr <ExploringNpc> exploringNpc;
+	std::shared_ptr<NpcCrowd> npcCrowd;
 };
 
 
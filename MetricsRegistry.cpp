@@ -0,0 +1,220 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "MetricsRegistry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <file/SettingsManager.h>
+
+MetricsRegistry* MetricsRegistry::instance = nullptr;
+
+void Histogram::Record(const double milliseconds)
+{
+    const auto microseconds = std::max(1.0, milliseconds * 1000.0);
+    const auto bucket = std::min(bucketCount - 1, static_cast<int>(std::log2(microseconds) * bucketsPerDoubling));
+
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    totalMs.fetch_add(milliseconds, std::memory_order_relaxed);
+
+    auto currentMax = max.load(std::memory_order_relaxed);
+    while (milliseconds > currentMax && !max.compare_exchange_weak(currentMax, milliseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+double Histogram::Mean() const
+{
+    const auto n = Count();
+    return n > 0 ? totalMs.load(std::memory_order_relaxed) / static_cast<double>(n) : 0;
+}
+
+double Histogram::Percentile(const double fraction) const
+{
+    const auto n = Count();
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    // The bucket the percentile falls in, then part way across it
+    const auto target = std::clamp(fraction, 0.0, 1.0) * static_cast<double>(n);
+    double seen = 0;
+
+    for (int bucket = 0; bucket < bucketCount; bucket++)
+    {
+        const auto inBucket = static_cast<double>(buckets[bucket].load(std::memory_order_relaxed));
+
+        if (inBucket > 0 && seen + inBucket >= target)
+        {
+            const auto lower = bucket == 0 ? 0.0 : BucketUpperBound(bucket - 1);
+            const auto upper = BucketUpperBound(bucket);
+            return std::min(Max(), lower + (upper - lower) * (target - seen) / inBucket);
+        }
+
+        seen += inBucket;
+    }
+
+    return Max();
+}
+
+double Histogram::BucketUpperBound(const int bucket)
+{
+    return std::exp2(static_cast<double>(bucket + 1) / bucketsPerDoubling) / 1000.0;
+}
+
+MetricsRegistry* MetricsRegistry::Get()
+{
+    if (instance == nullptr) { instance = new MetricsRegistry(); }
+    return instance;
+}
+
+Counter& MetricsRegistry::GetCounter(const std::string &name)
+{
+    std::lock_guard lock(mutex);
+    auto &counter = counters[name];
+    if (counter == nullptr) counter = std::make_unique<Counter>();
+    return *counter;
+}
+
+Gauge& MetricsRegistry::GetGauge(const std::string &name)
+{
+    std::lock_guard lock(mutex);
+    auto &gauge = gauges[name];
+    if (gauge == nullptr) gauge = std::make_unique<Gauge>();
+    return *gauge;
+}
+
+Histogram& MetricsRegistry::GetHistogram(const std::string &name)
+{
+    std::lock_guard lock(mutex);
+    auto &histogram = histograms[name];
+    if (histogram == nullptr) histogram = std::make_unique<Histogram>();
+    return *histogram;
+}
+
+std::vector<std::pair<std::string, double>> MetricsRegistry::Snapshot()
+{
+    std::vector<std::pair<std::string, double>> values;
+
+    std::lock_guard lock(mutex);
+
+    for (const auto &[name, counter] : counters)
+    {
+        values.emplace_back(name, static_cast<double>(counter->Get()));
+    }
+
+    for (const auto &[name, gauge] : gauges)
+    {
+        values.emplace_back(name, gauge->Get());
+    }
+
+    for (const auto &[name, histogram] : histograms)
+    {
+        values.emplace_back(name + ".count", static_cast<double>(histogram->Count()));
+        values.emplace_back(name + ".mean", histogram->Mean());
+        values.emplace_back(name + ".p50", histogram->Percentile(0.5));
+        values.emplace_back(name + ".p90", histogram->Percentile(0.9));
+        values.emplace_back(name + ".p99", histogram->Percentile(0.99));
+        values.emplace_back(name + ".max", histogram->Max());
+    }
+
+    std::sort(values.begin(), values.end());
+
+    return values;
+}
+
+void MetricsRegistry::StartDumping(const std::string &path, const unsigned intervalMs)
+{
+    StopDumping();
+
+    FILE* file = fopen(path.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        fprintf(stderr, "%s: error: unable to create %s\n", __func__, path.c_str());
+        return;
+    }
+
+    stopDumping = false;
+
+    dumpThread = std::thread([this, file, intervalMs]
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> columns;
+
+        std::unique_lock lock(dumpMutex);
+        while (!dumpStopped.wait_for(lock, std::chrono::milliseconds(intervalMs), [this] { return stopDumping; }))
+        {
+            Dump(file, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), columns);
+        }
+
+        // One last row so that nothing recorded since the last one is lost
+        Dump(file, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), columns);
+        fclose(file);
+    });
+}
+
+void MetricsRegistry::StopDumping()
+{
+    if (!dumpThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(dumpMutex);
+        stopDumping = true;
+    }
+
+    dumpStopped.notify_all();
+    dumpThread.join();
+}
+
+void MetricsRegistry::Dump(FILE* file, const double elapsedSeconds, std::vector<std::string> &columns)
+{
+    const auto values = Snapshot();
+
+    // A header row to start with and again whenever a new metric turns up
+    const bool sameColumns = values.size() == columns.size() &&
+        std::equal(values.begin(), values.end(), columns.begin(), [](const auto &value, const auto &column) { return value.first == column; });
+
+    if (!sameColumns)
+    {
+        columns.clear();
+        fprintf(file, "TimeSecs");
+        for (const auto &[name, value] : values)
+        {
+            fprintf(file, "\t%s", name.c_str());
+            columns.push_back(name);
+        }
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "%.0f", elapsedSeconds);
+    for (const auto &[name, value] : values)
+    {
+        fprintf(file, "\t%g", value);
+    }
+    fprintf(file, "\n");
+    fflush(file);
+}
+
+void MetricsRegistry::LoadSettings()
+{
+    const auto path = gamelib::SettingsManager::Get()->GetString("metrics", "DumpFilePath");
+    const auto intervalMs = gamelib::SettingsManager::Get()->GetInt("metrics", "DumpIntervalMs");
+
+    if (!path.empty() && intervalMs > 0)
+    {
+        StartDumping(path, static_cast<unsigned>(intervalMs));
+    }
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    StopDumping();
+}
@@ -0,0 +1,142 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_METRICSREGISTRY_H
+#define GAME3_METRICSREGISTRY_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// A count that only goes up, e.g. the number of tokens generated
+class Counter
+{
+public:
+    void Add(const uint64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value {0};
+};
+
+// The latest value of something, e.g. tokens per second of the last answer
+class Gauge
+{
+public:
+    void Set(const double newValue) { value.store(newValue, std::memory_order_relaxed); }
+    [[nodiscard]] double Get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value {0};
+};
+
+/**
+ * Latencies in milliseconds, counted into buckets that are a quarter of a power of two wide (from a microsecond to a
+ * few minutes), so percentiles are within about 10%. Recording is lock free and doesn't allocate, it is fine to do
+ * for every token.
+ */
+class Histogram
+{
+public:
+    void Record(double milliseconds);
+
+    [[nodiscard]] uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    [[nodiscard]] double Mean() const;
+    [[nodiscard]] double Max() const { return max.load(std::memory_order_relaxed); }
+
+    // e.g. 0.99 for the 99th percentile, 0 if nothing has been recorded
+    [[nodiscard]] double Percentile(double fraction) const;
+
+    static constexpr int bucketsPerDoubling = 4;
+    static constexpr int bucketCount = 28 * bucketsPerDoubling; // up to 2^28 microseconds, about 4.5 minutes
+
+private:
+    static double BucketUpperBound(int bucket);
+
+    std::array<std::atomic<uint64_t>, bucketCount> buckets {};
+    std::atomic<uint64_t> count {0};
+    std::atomic<double> totalMs {0};
+    std::atomic<double> max {0};
+};
+
+// Records how long it lives for into a histogram
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(Histogram &histogram) : histogram(histogram), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { histogram.Record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()); }
+
+    ScopedLatency(const ScopedLatency &) = delete;
+    ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+private:
+    Histogram &histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Process-wide counters, gauges and latency histograms, e.g. for how long the LLMs take to evaluate prompts and decode
+ * tokens. Metrics are made the first time they are asked for and live for as long as the process, so keep the
+ * reference rather than looking the name up each time:
+ *
+ *   static auto &decodeLatency = MetricsRegistry::Get()->GetHistogram("llm.decode_ms");
+ *
+ * Snapshot() gives every value by name, and StartDumping() appends them to a TSV file every so often (like
+ * statistics.txt) so they can be watched while the game runs.
+ */
+class MetricsRegistry
+{
+public:
+    static MetricsRegistry* Get();
+
+    Counter& GetCounter(const std::string &name);
+    Gauge& GetGauge(const std::string &name);
+    Histogram& GetHistogram(const std::string &name);
+
+    /**
+     * Every metric's current value, sorted by name. A histogram gives several: name.count, name.mean, name.p50,
+     * name.p90, name.p99 and name.max.
+     */
+    std::vector<std::pair<std::string, double>> Snapshot();
+
+    /**
+     * Appends a row with the snapshot to the file every intervalMs, starting with a header row (which is repeated if
+     * new metrics turn up). Dumping stops when StopDumping is called or the registry goes away.
+     */
+    void StartDumping(const std::string &path, unsigned intervalMs);
+    void StopDumping();
+
+    // Reads "metrics"/"DumpFilePath" and "metrics"/"DumpIntervalMs" and starts dumping if they are set
+    void LoadSettings();
+
+    ~MetricsRegistry();
+
+private:
+    MetricsRegistry() = default;
+
+    void Dump(FILE* file, double elapsedSeconds, std::vector<std::string> &columns);
+
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+
+    std::thread dumpThread;
+    std::mutex dumpMutex;
+    std::condition_variable dumpStopped;
+    bool stopDumping = false;
+
+    static MetricsRegistry* instance;
+};
+
+#endif //GAME3_METRICSREGISTRY_H
@@ -1 +1,79 @@
 #include "MoveProbabilityMatrix.h"
+
+MoveProbabilityMatrix::MoveProbabilityMatrix(const std::vector<std::shared_ptr<mazer::Room>>& rooms)
+	: cumulativeProbabilities(rooms.size() * directionCount, 0.0f)
+{
+	for (const auto& room : rooms)
+	{
+		SetOpenDirections(room->GetRoomNumber(), GetOpenDirections(*room));
+	}
+}
+
+MoveProbabilityMatrix::MoveProbabilityMatrix(const std::vector<uint8_t>& openDirections)
+	: cumulativeProbabilities(openDirections.size() * directionCount, 0.0f)
+{
+	for (int roomNumber = 0; roomNumber < static_cast<int>(openDirections.size()); roomNumber++)
+	{
+		SetOpenDirections(roomNumber, openDirections[roomNumber]);
+	}
+}
+
+void MoveProbabilityMatrix::SelectActions(const int* roomNumbers, NpcRandom* randoms, gamelib::Direction* directions, const int count) const
+{
+	for (int i = 0; i < count; i++)
+	{
+		directions[i] = SelectAction(roomNumbers[i], randoms[i]);
+	}
+}
+
+bool MoveProbabilityMatrix::CanFromRoomInDirection(const int roomNumber, const gamelib::Direction desiredDirection) const
+{
+	const float* cumulative = cumulativeProbabilities.data() + static_cast<size_t>(roomNumber) * directionCount;
+	const auto direction = static_cast<int>(desiredDirection);
+
+	// It's possible to move in a direction that has a share of the probability
+	return cumulative[direction] > (direction > 0 ? cumulative[direction - 1] : 0.0f);
+}
+
+uint8_t MoveProbabilityMatrix::GetOpenDirections(const mazer::Room& room)
+{
+	return static_cast<uint8_t>(
+		(!room.HasTopWall() << static_cast<int>(gamelib::Direction::Up)) |
+		(!room.HasBottomWall() << static_cast<int>(gamelib::Direction::Down)) |
+		(!room.HasLeftWall() << static_cast<int>(gamelib::Direction::Left)) |
+		(!room.HasRightWall() << static_cast<int>(gamelib::Direction::Right)));
+}
+
+void MoveProbabilityMatrix::Update(const mazer::Room& room)
+{
+	SetOpenDirections(room.GetRoomNumber(), GetOpenDirections(room));
+}
+
+void MoveProbabilityMatrix::SetOpenDirections(const int roomNumber, const uint8_t openDirections)
+{
+	// A room added since the matrix was made
+	if (roomNumber >= GetRoomCount())
+	{
+		cumulativeProbabilities.resize(static_cast<size_t>(roomNumber + 1) * directionCount, 0.0f);
+	}
+
+	float* cumulative = cumulativeProbabilities.data() + static_cast<size_t>(roomNumber) * directionCount;
+
+	int countPossibleMoves = 0;
+	for (int direction = 0; direction < directionCount; direction++)
+	{
+		countPossibleMoves += (openDirections >> direction) & 1;
+	}
+
+	// Each open direction gets an equal share
+	const float share = countPossibleMoves > 0 ? 1.0f / static_cast<float>(countPossibleMoves) : 0.0f;
+	int movesSoFar = 0;
+
+	for (int direction = 0; direction < directionCount; direction++)
+	{
+		movesSoFar += (openDirections >> direction) & 1;
+
+		// The last open direction ends exactly at 1 so that rounding can't leave a gap at the top
+		cumulative[direction] = movesSoFar == countPossibleMoves && countPossibleMoves > 0 ? 1.0f : static_cast<float>(movesSoFar) * share;
+	}
+}
@@ -0,0 +1,41 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "Navigation.h"
+
+#include <algorithm>
+#include <utility>
+
+Navigation::Navigation(RoomGraph graph, const int maxFlowFields)
+    : graph(std::move(graph)), maxFlowFields(std::max(1, maxFlowFields))
+{
+    flowFieldForRoom.assign(this->graph.GetRoomCount(), -1);
+}
+
+const FlowField& Navigation::GetFlowField(const int targetRoom)
+{
+    auto& index = flowFieldForRoom[targetRoom];
+
+    if (index < 0)
+    {
+        if (static_cast<int>(flowFields.size()) < maxFlowFields)
+        {
+            index = static_cast<int>(flowFields.size());
+            flowFields.push_back(std::make_unique<FlowField>(graph));
+        }
+        else
+        {
+            // Take over the field that was made longest ago
+            index = nextToReuse;
+            nextToReuse = (nextToReuse + 1) % maxFlowFields;
+            flowFieldForRoom[flowFields[index]->GetTarget()] = -1;
+        }
+    }
+
+    // Only searches if the field is new, was for another room or the walls have changed
+    auto& flowField = *flowFields[index];
+    flowField.SetTarget(targetRoom);
+
+    return flowField;
+}
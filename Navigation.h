@@ -0,0 +1,68 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NAVIGATION_H
+#define GAME3_NAVIGATION_H
+
+#include <memory>
+#include <vector>
+#include <Room.h>
+#include <character/Direction.h>
+
+#include "FlowField.h"
+#include "RoomGraph.h"
+
+/**
+ * Finds the way through the maze for NPCs that are heading somewhere, e.g. chasing the player or fetching a pickup.
+ * The room graph is built once per level and a flow field is kept for each room that is being headed for, so asking
+ * for the next move is a lookup however many NPCs ask. When the target moves, the field for its new room is searched
+ * once (or is already there if it has been that way before), and changing walls only redoes the fields as they are
+ * next asked for.
+ */
+class Navigation
+{
+public:
+    /**
+     * @param graph the level's rooms
+     * @param maxFlowFields how many targets to keep fields for, the least recently made one is reused after that
+     */
+    explicit Navigation(RoomGraph graph, int maxFlowFields = 16);
+
+    // The flow fields refer to the graph, so it stays where it is
+    Navigation(const Navigation& other) = delete;
+    Navigation& operator=(const Navigation& other) = delete;
+
+    // The first move from one room on a shortest way to another, Direction::None when there or if there is no way there
+    [[nodiscard]] gamelib::Direction GetNextDirection(const int fromRoom, const int targetRoom)
+    {
+        return GetFlowField(targetRoom).GetNextDirection(fromRoom);
+    }
+
+    [[nodiscard]] gamelib::Direction GetNextDirection(const std::shared_ptr<mazer::Room>& from, const std::shared_ptr<mazer::Room>& target)
+    {
+        return GetNextDirection(from->GetRoomNumber(), target->GetRoomNumber());
+    }
+
+    // The flow field towards a room, made (or brought up to date with the walls) if need be
+    const FlowField& GetFlowField(int targetRoom);
+
+    // Works out where the room leads again, e.g. after a RoomWallsChangedEvent
+    void Update(const mazer::Room& room) { graph.Update(room); }
+
+    /**
+     * @param openDirections a bit for each direction there is no wall in (1 << Direction)
+     */
+    void SetOpenDirections(const int roomNumber, const uint8_t openDirections) { graph.SetOpenDirections(roomNumber, openDirections); }
+
+    [[nodiscard]] const RoomGraph& GetGraph() const { return graph; }
+
+private:
+    RoomGraph graph;
+    std::vector<std::unique_ptr<FlowField>> flowFields;
+    std::vector<int> flowFieldForRoom; // index into flowFields for each target room, or -1
+    int maxFlowFields;
+    int nextToReuse = 0;
+};
+
+#endif //GAME3_NAVIGATION_H
@@ -0,0 +1,69 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "NpcCrowd.h"
+
+#include "JobSystem.h"
+#include "NpcRoomsChangedEvent.h"
+
+#include <utility>
+#include <SDL_render.h>
+#include <file/SettingsManager.h>
+
+NpcCrowd::NpcCrowd(std::shared_ptr<NpcSimulation> simulation) : simulation(std::move(simulation))
+{
+}
+
+void NpcCrowd::LoadSettings()
+{
+    const auto settings = gamelib::SettingsManager::Get();
+
+    simulation->SetSpeed(static_cast<float>(settings->GetInt("WanderingNPC", "crowdSpeed")));
+    simulation->SetPauseMs(static_cast<float>(settings->GetInt("WanderingNPC", "crowdPauseMs")));
+    npcSize = settings->GetInt("WanderingNPC", "crowdNpcSize");
+}
+
+std::string NpcCrowd::GetSubscriberName()
+{
+    return "NpcCrowd";
+}
+
+std::string NpcCrowd::GetName()
+{
+    return "NpcCrowd";
+}
+
+gamelib::GameObjectType NpcCrowd::GetGameObjectType()
+{
+    return gamelib::GameObjectType::game_defined;
+}
+
+void NpcCrowd::Update(const unsigned long deltaMs)
+{
+    // Spread across the job system's threads, it comes out the same as on one
+    simulation->Update(deltaMs, JobSystem::Get());
+
+    // One event for the whole crowd rather than one per NPC
+    if (!simulation->GetRoomChanges().empty())
+    {
+        RaiseEvent(std::make_shared<NpcRoomsChangedEvent>(simulation->GetRoomChanges()));
+    }
+}
+
+void NpcCrowd::Draw(SDL_Renderer *renderer)
+{
+    const auto &x = simulation->GetX();
+    const auto &y = simulation->GetY();
+    const int count = simulation->GetCount();
+    const int halfSize = npcSize / 2;
+
+    squares.resize(count);
+    for (int npc = 0; npc < count; npc++)
+    {
+        squares[npc] = { static_cast<int>(x[npc]) - halfSize, static_cast<int>(y[npc]) - halfSize, npcSize, npcSize };
+    }
+
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    SDL_RenderFillRects(renderer, squares.data(), count);
+}
@@ -0,0 +1,47 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NPCCROWD_H
+#define GAME3_NPCCROWD_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <SDL_rect.h>
+#include <objects/GameObject.h>
+
+#include "NpcSimulation.h"
+
+/**
+ * Puts an NpcSimulation in the scene: it is updated once a frame and every NPC is drawn as a small square in one call,
+ * so thousands of wandering NPCs cost about what one ExploringNpc does per frame. NPCs going into other rooms are
+ * raised together in an NpcRoomsChangedEvent.
+ */
+class NpcCrowd : public gamelib::GameObject
+{
+public:
+    explicit NpcCrowd(std::shared_ptr<NpcSimulation> simulation);
+
+    // Reads "WanderingNPC"/"crowdSpeed", "crowdPauseMs" and "crowdNpcSize"
+    void LoadSettings() override;
+
+    [[nodiscard]] std::shared_ptr<NpcSimulation> GetSimulation() const { return simulation; }
+
+    std::string GetSubscriberName() override;
+
+    std::string GetName() override;
+
+    gamelib::GameObjectType GetGameObjectType() override;
+
+    void Update(unsigned long deltaMs) override;
+
+    void Draw(SDL_Renderer *renderer) override;
+
+private:
+    std::shared_ptr<NpcSimulation> simulation;
+    std::vector<SDL_Rect> squares; // reused each frame
+    int npcSize = 6;
+};
+
+#endif //GAME3_NPCCROWD_H
@@ -0,0 +1,51 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "NpcDecisions.h"
+
+StructuredOutput<gamelib::Direction> NpcDecisions::NextDirection(const std::vector<gamelib::Direction> &allowed)
+{
+    std::vector<std::string> names;
+    for (const auto direction : allowed)
+    {
+        names.push_back(ToString(direction));
+    }
+
+    JsonObjectGrammar object;
+    object.Enum("direction", names);
+
+    return {
+        object.ToGbnf(),
+        [object, allowed](const std::string_view text) -> std::optional<gamelib::Direction>
+        {
+            const auto values = object.Parse(text);
+            if (!values)
+            {
+                return std::nullopt;
+            }
+
+            for (const auto direction : allowed)
+            {
+                if (ToString(direction) == values->at("direction"))
+                {
+                    return direction;
+                }
+            }
+
+            return std::nullopt;
+        }
+    };
+}
+
+std::string NpcDecisions::ToString(const gamelib::Direction direction)
+{
+    switch (direction)
+    {
+        case gamelib::Direction::Up: return "Up";
+        case gamelib::Direction::Down: return "Down";
+        case gamelib::Direction::Left: return "Left";
+        case gamelib::Direction::Right: return "Right";
+        default: return "None";
+    }
+}
@@ -0,0 +1,28 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NPCDECISIONS_H
+#define GAME3_NPCDECISIONS_H
+
+#include <string>
+#include <vector>
+#include <character/Direction.h>
+
+#include "StructuredOutput.h"
+
+// The structured answers an LLM can give when it decides something for an NPC
+class NpcDecisions
+{
+public:
+    /**
+     * Answered as {"direction": "Left"}
+     * @param allowed the directions that can be chosen, e.g. the ones without a wall in the way
+     */
+    static StructuredOutput<gamelib::Direction> NextDirection(const std::vector<gamelib::Direction> &allowed = {
+        gamelib::Direction::Up, gamelib::Direction::Down, gamelib::Direction::Left, gamelib::Direction::Right});
+
+    static std::string ToString(gamelib::Direction direction);
+};
+
+#endif //GAME3_NPCDECISIONS_H
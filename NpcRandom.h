@@ -0,0 +1,50 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NPCRANDOM_H
+#define GAME3_NPCRANDOM_H
+
+#include <cstdint>
+
+/**
+ * A small, fast random number generator (PCG32) for each NPC to make its decisions with. Each one is 16 bytes, so
+ * every NPC can have its own rather than sharing one (which would need a lock or make them all depend on the order
+ * they are updated in). Giving two NPCs different streams makes their sequences different even with the same seed.
+ * It is a UniformRandomBitGenerator, so it works with the <random> distributions too.
+ */
+class NpcRandom
+{
+public:
+    using result_type = uint32_t;
+
+    explicit NpcRandom(const uint64_t seed = 0x853c49e6748fea9bULL, const uint64_t stream = 0xda3e39cb94b95bdbULL)
+        : increment((stream << 1u) | 1u)
+    {
+        Next();
+        state += seed;
+        Next();
+    }
+
+    uint32_t Next()
+    {
+        const uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        const auto xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        const auto rotation = static_cast<uint32_t>(old >> 59u);
+        return (xorShifted >> rotation) | (xorShifted << ((0u - rotation) & 31u));
+    }
+
+    // Uniform in [0, 1), the top 24 bits are exactly representable so 1 is never returned
+    float NextFloat() { return static_cast<float>(Next() >> 8) * (1.0f / 16777216.0f); }
+
+    result_type operator()() { return Next(); }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+private:
+    uint64_t state = 0;
+    uint64_t increment;
+};
+
+#endif //GAME3_NPCRANDOM_H
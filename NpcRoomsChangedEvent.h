@@ -0,0 +1,32 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NPCROOMSCHANGEDEVENT_H
+#define GAME3_NPCROOMSCHANGEDEVENT_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EventNumbers.h"
+#include "NpcSimulation.h"
+#include <events/Event.h>
+
+const static gamelib::EventId NpcRoomsChangedEventId(NpcRoomsChanged, "NpcRoomsChangedEvent");
+
+// Raised by the NPC crowd after an update in which any of its NPCs went into another room
+class NpcRoomsChangedEvent final : public gamelib::Event
+{
+public:
+    explicit NpcRoomsChangedEvent(std::vector<NpcSimulation::RoomChange> changes) : Event(NpcRoomsChangedEventId), Changes(std::move(changes))
+    {
+    }
+
+    // In NPC order, the same whichever threads updated the crowd
+    std::vector<NpcSimulation::RoomChange> Changes;
+
+    std::string ToString() override { return "NpcRoomsChangedEvent"; }
+};
+
+#endif //GAME3_NPCROOMSCHANGEDEVENT_H
@@ -0,0 +1,151 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "NpcSimulation.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    // Which way each direction moves on screen, in the order of gamelib::Direction (up, down, left, right)
+    constexpr float stepX[] = { 0.0f, 0.0f, -1.0f, 1.0f };
+    constexpr float stepY[] = { -1.0f, 1.0f, 0.0f, 0.0f };
+}
+
+NpcSimulation::NpcSimulation(std::shared_ptr<MoveProbabilityMatrix> moveProbabilityMatrix, std::shared_ptr<Navigation> navigation, const RoomLayout &layout)
+    : moveProbabilityMatrix(std::move(moveProbabilityMatrix)), navigation(std::move(navigation)), layout(layout)
+{
+}
+
+int NpcSimulation::Add(const int roomNumber, const uint64_t seed)
+{
+    const int column = roomNumber % layout.columns;
+    const int row = roomNumber / layout.columns;
+
+    x.push_back(layout.left + (static_cast<float>(column) + 0.5f) * layout.roomWidth);
+    y.push_back(layout.top + (static_cast<float>(row) + 0.5f) * layout.roomHeight);
+    remaining.push_back(0.0f);
+    waitMs.push_back(0.0f);
+    rooms.push_back(roomNumber);
+    nextRooms.push_back(roomNumber);
+    directions.push_back(gamelib::Direction::None);
+    states.push_back(State::Waiting);
+
+    // A stream each, so NPCs given the same seed still go their own ways
+    randoms.emplace_back(seed, static_cast<uint64_t>(rooms.size()));
+
+    return GetCount() - 1;
+}
+
+void NpcSimulation::Clear()
+{
+    for (auto* values : { &x, &y, &remaining, &waitMs })
+    {
+        values->clear();
+    }
+    rooms.clear();
+    nextRooms.clear();
+    directions.clear();
+    states.clear();
+    randoms.clear();
+    roomChanges.clear();
+}
+
+void NpcSimulation::Update(const unsigned long deltaMs, JobSystem* jobs)
+{
+    const auto elapsedMs = static_cast<float>(deltaMs);
+    const int count = GetCount();
+    const int chunkCount = (count + npcsPerChunk - 1) / npcsPerChunk;
+
+    chunkRoomChanges.resize(chunkCount);
+
+    const auto updateChunk = [&](const int chunk)
+    {
+        auto &changes = chunkRoomChanges[chunk];
+        changes.clear();
+        UpdateRange(chunk * npcsPerChunk, std::min(count, (chunk + 1) * npcsPerChunk), elapsedMs, changes);
+    };
+
+    if (jobs != nullptr)
+    {
+        jobs->ParallelFor(chunkCount, updateChunk);
+    }
+    else
+    {
+        for (int chunk = 0; chunk < chunkCount; chunk++)
+        {
+            updateChunk(chunk);
+        }
+    }
+
+    // Chunk by chunk, so the changes are in NPC order whichever threads made them
+    roomChanges.clear();
+    for (int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        roomChanges.insert(roomChanges.end(), chunkRoomChanges[chunk].begin(), chunkRoomChanges[chunk].end());
+    }
+}
+
+void NpcSimulation::UpdateRange(const int first, const int last, const float elapsedMs, std::vector<RoomChange> &changes)
+{
+    const float step = pixelsPerMs * elapsedMs;
+    const float roomLength[] = { layout.roomHeight, layout.roomHeight, layout.roomWidth, layout.roomWidth };
+
+    for (int npc = first; npc < last; npc++)
+    {
+        if (states[npc] == State::Waiting)
+        {
+            waitMs[npc] -= elapsedMs;
+            if (waitMs[npc] > 0.0f)
+            {
+                continue;
+            }
+
+            Decide(npc);
+            if (states[npc] == State::Waiting)
+            {
+                continue;
+            }
+        }
+
+        // Never past the middle of the next room, the NPC decides again there
+        const auto direction = static_cast<int>(directions[npc]);
+        const float moved = std::min(step, remaining[npc]);
+        x[npc] += stepX[direction] * moved;
+        y[npc] += stepY[direction] * moved;
+        remaining[npc] -= moved;
+
+        // Past the wall half way along, the NPC is in the next room
+        if (remaining[npc] <= roomLength[direction] * 0.5f && rooms[npc] != nextRooms[npc])
+        {
+            changes.push_back({npc, rooms[npc], nextRooms[npc]});
+            rooms[npc] = nextRooms[npc];
+        }
+
+        if (remaining[npc] <= 0.0f)
+        {
+            states[npc] = State::Waiting;
+            waitMs[npc] = pauseMs;
+        }
+    }
+}
+
+void NpcSimulation::Decide(const int npc)
+{
+    const auto direction = moveProbabilityMatrix->SelectAction(rooms[npc], randoms[npc]);
+    const int nextRoom = navigation->GetGraph().GetNeighbour(rooms[npc], direction);
+
+    // A room with no way out (the matrix falls back to right), try again next update in case a wall goes
+    if (nextRoom == RoomGraph::noRoom)
+    {
+        return;
+    }
+
+    const bool vertical = direction == gamelib::Direction::Up || direction == gamelib::Direction::Down;
+    directions[npc] = direction;
+    nextRooms[npc] = nextRoom;
+    remaining[npc] = vertical ? layout.roomHeight : layout.roomWidth;
+    states[npc] = State::Moving;
+}
@@ -0,0 +1,117 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NPCSIMULATION_H
+#define GAME3_NPCSIMULATION_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <character/Direction.h>
+
+#include "JobSystem.h"
+#include "MoveProbabilityMatrix.h"
+#include "Navigation.h"
+#include "NpcRandom.h"
+
+// Where the rooms are on screen, they are all the same size and laid out row by row from the top left
+struct RoomLayout
+{
+    float left = 0;
+    float top = 0;
+    float roomWidth = 0;
+    float roomHeight = 0;
+    int columns = 1;
+};
+
+/**
+ * Lots of wandering NPCs updated together. Each NPC is an index into arrays of positions, directions, rooms and states
+ * rather than an object with a behaviour tree, so an update is one loop over memory that is next to each other with no
+ * virtual calls or shared_ptrs to follow. NPCs wander the same way an ExploringNpc does: from the middle of a room they
+ * pick a way out with the move probability matrix, walk to the middle of the next room and pick again.
+ */
+class NpcSimulation
+{
+public:
+    enum class State : uint8_t
+    {
+        Waiting, // in the middle of a room, picks a direction when the wait is over
+        Moving   // on the way to the middle of the next room
+    };
+
+    // An NPC going through a gap in the wall into another room
+    struct RoomChange
+    {
+        int npc;
+        int fromRoom;
+        int toRoom;
+    };
+
+    NpcSimulation(std::shared_ptr<MoveProbabilityMatrix> moveProbabilityMatrix, std::shared_ptr<Navigation> navigation, const RoomLayout &layout);
+
+    /**
+     * Puts a new NPC in the middle of a room
+     * @param seed seeds the NPC's random numbers, so the same seed wanders the same way
+     * @return the NPC's index
+     */
+    int Add(int roomNumber, uint64_t seed);
+
+    void Clear();
+
+    /**
+     * Moves every NPC on by deltaMs
+     * @param jobs if given, NPCs are updated a chunk at a time across its threads. Each NPC only depends on its own
+     * state and random numbers, so the result is the same as updating them on one thread.
+     */
+    void Update(unsigned long deltaMs, JobSystem* jobs = nullptr);
+
+    // Which NPCs went into another room during the last update, in NPC order
+    [[nodiscard]] const std::vector<RoomChange>& GetRoomChanges() const { return roomChanges; }
+
+    // How far NPCs move each second
+    void SetSpeed(float pixelsPerSecond) { pixelsPerMs = pixelsPerSecond / 1000.0f; }
+
+    // How long NPCs stand in the middle of each room before moving on
+    void SetPauseMs(float pauseMs) { this->pauseMs = pauseMs; }
+
+    [[nodiscard]] int GetCount() const { return static_cast<int>(rooms.size()); }
+
+    // The middle of each NPC
+    [[nodiscard]] const std::vector<float>& GetX() const { return x; }
+    [[nodiscard]] const std::vector<float>& GetY() const { return y; }
+
+    [[nodiscard]] const std::vector<int>& GetRooms() const { return rooms; }
+    [[nodiscard]] const std::vector<gamelib::Direction>& GetDirections() const { return directions; }
+    [[nodiscard]] const std::vector<State>& GetStates() const { return states; }
+
+private:
+    // NPCs are updated in chunks of this many, small enough to share out and big enough that a chunk is worth a thread
+    static constexpr int npcsPerChunk = 1024;
+
+    void UpdateRange(int first, int last, float elapsedMs, std::vector<RoomChange> &changes);
+    void Decide(int npc);
+
+    std::shared_ptr<MoveProbabilityMatrix> moveProbabilityMatrix;
+    std::shared_ptr<Navigation> navigation;
+    RoomLayout layout;
+    float pixelsPerMs = 0.06f;
+    float pauseMs = 0;
+
+    // One of each per NPC
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> remaining; // how far there is to go to the middle of the next room
+    std::vector<float> waitMs;
+    std::vector<int> rooms;
+    std::vector<int> nextRooms;
+    std::vector<gamelib::Direction> directions;
+    std::vector<State> states;
+    std::vector<NpcRandom> randoms;
+
+    // Each chunk's room changes go in its own buffer while the chunks are updated, then are put together in order
+    std::vector<std::vector<RoomChange>> chunkRoomChanges;
+    std::vector<RoomChange> roomChanges;
+};
+
+#endif //GAME3_NPCSIMULATION_H
@@ -0,0 +1,65 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "RoomGraph.h"
+
+#include <cstdio>
+
+#include "MoveProbabilityMatrix.h"
+
+RoomGraph::RoomGraph(const std::vector<std::shared_ptr<mazer::Room>>& rooms, const int columns)
+    : columns(columns), roomCount(static_cast<int>(rooms.size())), neighbours(rooms.size() * directionCount, noRoom)
+{
+    for (const auto& room : rooms)
+    {
+        SetOpenDirections(room->GetRoomNumber(), MoveProbabilityMatrix::GetOpenDirections(*room));
+    }
+}
+
+RoomGraph::RoomGraph(const std::vector<uint8_t>& openDirections, const int columns)
+    : columns(columns), roomCount(static_cast<int>(openDirections.size())), neighbours(openDirections.size() * directionCount, noRoom)
+{
+    for (int roomNumber = 0; roomNumber < roomCount; roomNumber++)
+    {
+        SetOpenDirections(roomNumber, openDirections[roomNumber]);
+    }
+}
+
+int RoomGraph::GetAdjacent(const int roomNumber, const gamelib::Direction direction) const
+{
+    int adjacent = noRoom;
+
+    switch (direction)
+    {
+        case gamelib::Direction::Up: adjacent = roomNumber - columns; break;
+        case gamelib::Direction::Down: adjacent = roomNumber + columns; break;
+        case gamelib::Direction::Left: adjacent = roomNumber % columns == 0 ? noRoom : roomNumber - 1; break;
+        case gamelib::Direction::Right: adjacent = (roomNumber + 1) % columns == 0 ? noRoom : roomNumber + 1; break;
+        default: break;
+    }
+
+    return adjacent >= 0 && adjacent < roomCount ? adjacent : noRoom;
+}
+
+void RoomGraph::Update(const mazer::Room& room)
+{
+    SetOpenDirections(room.GetRoomNumber(), MoveProbabilityMatrix::GetOpenDirections(room));
+}
+
+void RoomGraph::SetOpenDirections(const int roomNumber, const uint8_t openDirections)
+{
+    if (roomNumber < 0 || roomNumber >= roomCount)
+    {
+        fprintf(stderr, "%s: error: room %d isn't in the maze\n", __func__, roomNumber);
+        return;
+    }
+
+    for (int direction = 0; direction < directionCount; direction++)
+    {
+        const auto side = static_cast<gamelib::Direction>(direction);
+        neighbours[static_cast<size_t>(roomNumber) * directionCount + direction] = (openDirections >> direction) & 1 ? GetAdjacent(roomNumber, side) : noRoom;
+    }
+
+    version++;
+}
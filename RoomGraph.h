@@ -0,0 +1,74 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_ROOMGRAPH_H
+#define GAME3_ROOMGRAPH_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <Room.h>
+#include <character/Direction.h>
+
+/**
+ * Which room is through each side of each room, built from the rooms' walls. Rooms are numbered row by row from the
+ * top left, as in the level files, so the room above is a row's worth of rooms back. A side with a wall (or at the edge
+ * of the maze) leads nowhere.
+ */
+class RoomGraph
+{
+public:
+    static constexpr int noRoom = -1;
+
+    /**
+     * @param rooms every room in the level, indexed by room number
+     * @param columns how many rooms there are in each row
+     */
+    RoomGraph(const std::vector<std::shared_ptr<mazer::Room>>& rooms, int columns);
+
+    /**
+     * @param openDirections for each room number, a bit for each direction there is no wall in (1 << Direction)
+     * @param columns how many rooms there are in each row
+     */
+    RoomGraph(const std::vector<uint8_t>& openDirections, int columns);
+
+    // The room through that side of the room, or noRoom if there is a wall in the way
+    [[nodiscard]] int GetNeighbour(const int roomNumber, const gamelib::Direction direction) const
+    {
+        return neighbours[static_cast<size_t>(roomNumber) * directionCount + static_cast<int>(direction)];
+    }
+
+    // The room next to this one on that side, whether or not there is a wall in between (noRoom past the edge)
+    [[nodiscard]] int GetAdjacent(int roomNumber, gamelib::Direction direction) const;
+
+    // Works out where the room leads again from its walls, e.g. after a RoomWallsChangedEvent
+    void Update(const mazer::Room& room);
+
+    /**
+     * @param openDirections a bit for each direction there is no wall in (1 << Direction)
+     */
+    void SetOpenDirections(int roomNumber, uint8_t openDirections);
+
+    [[nodiscard]] int GetRoomCount() const { return roomCount; }
+    [[nodiscard]] int GetColumns() const { return columns; }
+
+    // Goes up each time a wall changes, so anything worked out from the graph can tell it is out of date
+    [[nodiscard]] uint64_t GetVersion() const { return version; }
+
+    static gamelib::Direction Opposite(const gamelib::Direction direction)
+    {
+        // Up and down, left and right are next to each other in the enum
+        return static_cast<gamelib::Direction>(static_cast<int>(direction) ^ 1);
+    }
+
+private:
+    static constexpr int directionCount = 4; // up, down, left, right
+
+    int columns;
+    int roomCount;
+    uint64_t version = 0;
+    std::vector<int> neighbours; // directionCount per room
+};
+
+#endif //GAME3_ROOMGRAPH_H
@@ -0,0 +1,33 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_ROOMWALLSCHANGEDEVENT_H
+#define GAME3_ROOMWALLSCHANGEDEVENT_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "EventNumbers.h"
+#include <events/Event.h>
+#include <Room.h>
+
+const static gamelib::EventId RoomWallsChangedEventId(RoomWallsChanged, "RoomWallsChangedEvent");
+
+// Raised after walls are added or removed while a level is being played, e.g. by a maze whose walls move
+class RoomWallsChangedEvent final : public gamelib::Event
+{
+public:
+    explicit RoomWallsChangedEvent(std::vector<std::shared_ptr<mazer::Room>> rooms) : Event(RoomWallsChangedEventId), Rooms(std::move(rooms))
+    {
+    }
+
+    // Every room with a wall that changed. Neighbouring rooms each have their own side of a wall, so removing the wall
+    // between two rooms changes both of them.
+    std::vector<std::shared_ptr<mazer::Room>> Rooms;
+
+    std::string ToString() override { return "RoomWallsChangedEvent"; }
+};
+
+#endif //GAME3_ROOMWALLSCHANGEDEVENT_H
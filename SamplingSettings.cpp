@@ -0,0 +1,64 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "SamplingSettings.h"
+
+#include <cstdio>
+#include <file/SettingsManager.h>
+
+namespace
+{
+    // Settings only have strings, ints and bools, so fractional values are kept as strings
+    float GetFloat(const std::string &section, const std::string &name, const float defaultValue)
+    {
+        const auto value = gamelib::SettingsManager::Get()->GetString(section, name);
+
+        try
+        {
+            return value.empty() ? defaultValue : std::stof(value);
+        }
+        catch (const std::exception &)
+        {
+            fprintf(stderr, "%s: error: %s/%s is not a number, using %.2f\n", __func__, section.c_str(), name.c_str(), defaultValue);
+            return defaultValue;
+        }
+    }
+}
+
+common_params_sampling SamplingSettings::Load(const std::string &section)
+{
+    const auto settingsManager = gamelib::SettingsManager::Get();
+
+    common_params_sampling parameters;
+
+    parameters.temp = GetFloat(section, "Temperature", parameters.temp);
+    parameters.top_k = settingsManager->GetInt(section, "TopK");
+    parameters.top_p = GetFloat(section, "TopP", parameters.top_p);
+    parameters.min_p = GetFloat(section, "MinP", parameters.min_p);
+    parameters.penalty_repeat = GetFloat(section, "RepeatPenalty", parameters.penalty_repeat);
+    parameters.penalty_last_n = settingsManager->GetInt(section, "RepeatLastN");
+    parameters.seed = static_cast<uint32_t>(settingsManager->GetInt(section, "Seed"));
+
+    // Only the samplers that can be set from the settings, in the order llama.cpp normally applies them
+    parameters.samplers = {
+        COMMON_SAMPLER_TYPE_PENALTIES,
+        COMMON_SAMPLER_TYPE_TOP_K,
+        COMMON_SAMPLER_TYPE_TOP_P,
+        COMMON_SAMPLER_TYPE_MIN_P,
+        COMMON_SAMPLER_TYPE_TEMPERATURE,
+    };
+
+    return parameters;
+}
+
+common_params_sampling SamplingSettings::Greedy()
+{
+    common_params_sampling parameters;
+
+    // A temperature of 0 leaves only the most likely token for the final pick
+    parameters.temp = 0.0f;
+    parameters.samplers = { COMMON_SAMPLER_TYPE_TEMPERATURE };
+
+    return parameters;
+}
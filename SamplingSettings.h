@@ -0,0 +1,29 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_SAMPLINGSETTINGS_H
+#define GAME3_SAMPLINGSETTINGS_H
+
+#include <string>
+
+#include "common.h"
+
+/**
+ * Reads how the next token is picked from a section of settings.xml. Each NPC can have its own section to give it its
+ * own sampling "personality" (e.g. a hotter temperature for a chatty NPC), "sampling" is the default.
+ */
+class SamplingSettings
+{
+public:
+    /**
+     * @param section settings section holding Temperature, TopK, TopP, MinP, RepeatPenalty, RepeatLastN and Seed
+     * @return the sampling parameters, a temperature of 0 always picks the most likely token
+     */
+    static common_params_sampling Load(const std::string &section = "sampling");
+
+    // Always picks the most likely token, what the LLMs did before sampling was configurable
+    static common_params_sampling Greedy();
+};
+
+#endif //GAME3_SAMPLINGSETTINGS_H
@@ -1,57 +1,99 @@
 #include "SimpleLLM.h"
 
 #include "common.h"
+#include "EmbeddingCacheFile.h"
+#include "LLMModelRegistry.h"
+#include "LLMSessionFile.h"
+#include "LLMMetrics.h"
+#include "SamplingSettings.h"
 #include <ctime>
 #include <algorithm>
+#include <filesystem>
 
 void SimpleLLM::Initialize(const std::string &model_path, const int ngl)
 {
-    // load dynamic backends
-    ggml_backend_load_all();
-
     InitializeModel(model_path, ngl);
 
-    vocab = llama_model_get_vocab(model);
+    vocab = llama_model_get_vocab(model.get());
+
+    InitializeSampler();
 }
 
-std::string SimpleLLM::Infer(const std::string &userPrompt, const int n_predict)
+void SimpleLLM::SetSamplingParameters(const common_params_sampling &parameters)
 {
-    InitializeContext(userPrompt, n_predict);
+    samplingParameters = parameters;
+    useSamplingSettings = false;
+
+    if (model != nullptr)
+    {
+        InitializeSampler();
+    }
+}
+
+void SimpleLLM::SetSessionDirectory(const std::string &directory, const uint64_t maxBytes)
+{
+    sessionDirectory = directory;
+    maxSessionBytes = maxBytes;
+}
 
-    auto samplerParameters = llama_sampler_chain_default_params();
+std::string SimpleLLM::Infer(const std::string &userPrompt, const int n_predict)
+{
+    return Generate(userPrompt, n_predict, sampler.get(), nullptr);
+}
 
-    samplerParameters.no_perf = false;
+std::string SimpleLLM::Generate(const std::string &userPrompt, const int n_predict, common_sampler* tokenSampler,
+                                const std::function<bool(std::string_view response)> &isComplete)
+{
+    auto &metrics = LLMMetrics::Get();
+    const auto t_start = ggml_time_us();
+    lastStats = {};
+    metrics.prompts.Add();
 
-    // Initialize the sampler
-    smpl = llama_sampler_chain_init(samplerParameters);
+    InitializeContext(userPrompt, n_predict);
 
-    llama_sampler_chain_add(smpl, llama_sampler_init_greedy());
+    // The sampler is kept between prompts, it only needs to forget the last one
+    common_sampler_reset(tokenSampler);
 
     // print the prompt token-by-token
 
+    tokenDecoder.SetVocab(vocab);
+    tokenDecoder.Reset();
+
     for (auto id : prompt_tokens)
     {
-        char buf[128];
-        int n = llama_token_to_piece(vocab, id, buf, sizeof(buf), 0, true);
-        if (n < 0) {
-            fprintf(stderr, "%s: error: failed to convert token to piece\n", __func__);
-        }
-        std::string s(buf, n);
-        printf("%s", s.c_str());
+        const auto text = tokenDecoder.Decode(id);
+        fwrite(text.data(), 1, text.size(), stdout);
+
+        // The prompt counts towards the repeat penalty
+        common_sampler_accept(tokenSampler, id, false);
+    }
+
+    tokenDecoder.Reset();
+
+    // Skip the part of the prompt that is already in the KV cache from a previous prompt
+    auto n_past = ReuseCachedPrefix();
+    const auto cachePrompt = !llama_model_has_encoder(model.get());
+
+    // Failing that, the prompt may have been evaluated and saved before (e.g. on a previous run)
+    const auto sessionPath = cachePrompt && !sessionDirectory.empty() ? LLMSessionFile::PathFor(sessionDirectory, modelHash, prompt_tokens) : "";
+    if (n_past == 0 && !sessionPath.empty())
+    {
+        n_past = RestoreSession(sessionPath);
     }
+    auto saveSession = !sessionPath.empty() && n_past == 0 && !std::filesystem::exists(sessionPath);
 
-    // Prepare a batch for the prompt
+    // Prepare a batch for the rest of the prompt
 
-    auto batch = llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size());
+    auto batch = llama_batch_get_one(prompt_tokens.data() + n_past, static_cast<int32_t>(prompt_tokens.size()) - n_past);
 
-    if (llama_model_has_encoder(model))
+    if (llama_model_has_encoder(model.get()))
     {
-        if (llama_encode(ctx, batch))
+        if (llama_encode(ctx.get(), batch))
         {
             fprintf(stderr, "%s : failed to eval\n", __func__);
         }
 
-        auto decoder_start_token_id = llama_model_decoder_start_token(model);
+        auto decoder_start_token_id = llama_model_decoder_start_token(model.get());
 
         if (decoder_start_token_id == LLAMA_TOKEN_NULL)
         {
@@ -67,36 +109,89 @@ std::string SimpleLLM::Infer(const std::string &userPrompt, const int n_predict)
     int n_decode = 0;
     llama_token new_token_id;
 
-    std::stringstream response;
+    // Appended to in place, a token is rarely more than a few characters
+    std::string response;
+    response.reserve(static_cast<size_t>(n_predict) * 8);
 
-    for (int n_pos = 0; n_pos + batch.n_tokens < numTokensInPrompt + n_predict; )
+    for (int n_pos = n_past; n_pos + batch.n_tokens < numTokensInPrompt + n_predict; )
     {
+        const auto t_decode_start = ggml_time_us();
+
         // Evaluate the current batch with the transformer model
-        if (llama_decode(ctx, batch)) {
+        const auto decodeFailed = llama_decode(ctx.get(), batch) != 0;
+        const auto decodeMs = (ggml_time_us() - t_decode_start) / 1000.0;
+
+        if (decodeFailed)
+        {
             fprintf(stderr, "%s : failed to eval, return code %d\n", __func__, 1);
         }
+        else if (cachePrompt)
+        {
+            // Remember what is now in the KV cache so that the next prompt can reuse it
+            cachedTokens.insert(cachedTokens.end(), batch.token, batch.token + batch.n_tokens);
+
+            // Only the prompt has been evaluated so far, which is what the next run wants
+            if (saveSession)
+            {
+                if (LLMSessionFile::Save(sessionPath, ctx.get(), 0, modelHash, cachedTokens))
+                {
+                    LLMSessionFile::Trim(sessionDirectory, maxSessionBytes, sessionPath);
+                }
+                saveSession = false;
+            }
+        }
+
+        // The first batch is (what isn't cached of) the prompt
+        if (n_pos == n_past)
+        {
+            lastStats.promptTokens = batch.n_tokens;
+            lastStats.promptMs = (ggml_time_us() - t_main_start) / 1000.0;
+            metrics.promptEvalMs.Record(decodeMs);
+            metrics.promptTokens.Add(batch.n_tokens);
+        }
+        else
+        {
+            metrics.decodeMs.Record(decodeMs);
+        }
 
         n_pos += batch.n_tokens;
 
         // sample the next token
         {
-            new_token_id = llama_sampler_sample(smpl, ctx, -1);
+            // With a grammar, the sampled token is checked against it and only when it doesn't fit is the whole
+            // vocab constrained and sampled again. That is much quicker than constraining every token up front.
+            {
+                ScopedLatency sampling(metrics.sampleMs);
+                new_token_id = common_sampler_sample(tokenSampler, ctx.get(), -1, false);
+                common_sampler_accept(tokenSampler, new_token_id, true);
+            }
 
             // is it an end of generation?
             if (llama_vocab_is_eog(vocab, new_token_id)) {
                 break;
             }
 
-            // Convert token to character?
-            char buf[128];
-            int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
-            if (n < 0) {
-                fprintf(stderr, "%s: error: failed to convert token to piece\n", __func__);
+            // Convert token to characters (none if it only starts a character that the next token finishes)
+            {
+                ScopedLatency detokenizing(metrics.detokenizeMs);
+                const auto text = tokenDecoder.Decode(new_token_id);
+                fwrite(text.data(), 1, text.size(), stdout);
+                response.append(text);
+                fflush(stdout);
+            }
+
+            if (n_decode == 0)
+            {
+                lastStats.firstTokenMs = (ggml_time_us() - t_start) / 1000.0;
+                metrics.firstTokenMs.Record(lastStats.firstTokenMs);
+            }
+
+            // No need to wait for an end of generation token once a structured answer is finished
+            if (isComplete && isComplete(response))
+            {
+                n_decode += 1;
+                break;
             }
-            std::string s(buf, n);
-            printf("%s", s.c_str());
-            response << s;
-            fflush(stdout);
 
             // prepare the next batch with the sampled token
             batch = llama_batch_get_one(&new_token_id, 1);
@@ -109,12 +204,13 @@ std::string SimpleLLM::Infer(const std::string &userPrompt, const int n_predict)
 
     const auto t_main_end = ggml_time_us();
 
-    fprintf(stderr, "%s: decoded %d tokens in %.2f s, speed: %.2f t/s\n",
-            __func__, n_decode, (t_main_end - t_main_start) / 1000000.0f, n_decode / ((t_main_end - t_main_start) / 1000000.0f));
+    lastStats.generatedTokens = n_decode;
+    lastStats.generationMs = (t_main_end - t_main_start) / 1000.0 - lastStats.promptMs;
 
-    fprintf(stderr, "\n");
+    metrics.generatedTokens.Add(n_decode);
+    metrics.generationTokensPerSecond.Set(lastStats.GenerationTokensPerSecond());
 
-    return response.str();
+    return response;
 }
 
 void SimpleLLM::InitializeModel(const std::string &modelPath, const int ngl)
@@ -123,39 +219,139 @@ void SimpleLLM::InitializeModel(const std::string &modelPath, const int ngl)
 
     modelParameters.n_gpu_layers = ngl;
 
-    model = llama_model_load_from_file(modelPath.c_str(), modelParameters);
+    // Share the model with anyone else that has already loaded it
+    model = LLMModelRegistry::Get()->AcquireModel(modelPath, modelParameters);
 
     if (model == nullptr)
     {
         fprintf(stderr, "%s: error: unable to load model\n", __func__);
     }
+
+    // Saved sessions are only restored into the model that made them
+    modelHash = EmbeddingCacheFile::HashModelFile(modelPath);
 }
 
-void SimpleLLM::InitializeContext(const std::string &userPrompt, const int n_predict)
+void SimpleLLM::InitializeSampler()
+{
+    if (useSamplingSettings)
+    {
+        samplingParameters = SamplingSettings::Load();
+    }
+
+    sampler = std::shared_ptr<common_sampler>(common_sampler_init(model.get(), samplingParameters), common_sampler_free);
+
+    // These were built with the old parameters
+    grammarSamplers.clear();
+}
+
+common_sampler* SimpleLLM::GetGrammarSampler(const std::string &grammar)
 {
+    // Parsing a grammar isn't free, so each one is only parsed the first time it is used
+    auto &grammarSampler = grammarSamplers[grammar];
 
-    prompt_tokens.clear();
+    if (grammarSampler == nullptr)
+    {
+        auto parameters = samplingParameters;
+        parameters.grammar = grammar;
+
+        grammarSampler = std::shared_ptr<common_sampler>(common_sampler_init(model.get(), parameters), common_sampler_free);
 
-    numTokensInPrompt = -llama_tokenize(vocab, userPrompt.c_str(), userPrompt.size(), nullptr, 0, true, true);
+        if (grammarSampler == nullptr)
+        {
+            fprintf(stderr, "%s: error: failed to parse the grammar\n", __func__);
+            grammarSamplers.erase(grammar);
+            return sampler.get();
+        }
+    }
 
-    prompt_tokens.resize(numTokensInPrompt);
+    return grammarSampler.get();
+}
 
-    if (llama_tokenize(vocab, userPrompt.c_str(), userPrompt.size(), prompt_tokens.data(), prompt_tokens.size(), true, true) < 0)
+void SimpleLLM::InitializeContext(const std::string &userPrompt, const int n_predict)
+{
+    // One pass, into the last prompt's vector
+    if (!TokenizeText(vocab, userPrompt, prompt_tokens))
     {
         fprintf(stderr, "%s: error: failed to tokenize the prompt\n", __func__);
     }
 
+    numTokensInPrompt = static_cast<int>(prompt_tokens.size());
+
+    const uint32_t requiredContextSize = numTokensInPrompt + n_predict - 1;
+
+    // Keep using the current context (and the prompt prefix cached in it) if the new prompt fits
+    if (ctx != nullptr && llama_n_ctx(ctx.get()) >= requiredContextSize)
+    {
+        return;
+    }
+
     auto contextParameters = llama_context_default_params();
 
-    contextParameters.n_ctx = numTokensInPrompt + n_predict - 1; // Set the context size
-    contextParameters.n_batch = numTokensInPrompt; // Set the maximum number of tokens that can be processed in a single call to llama_decode
+    // Round up the context size so that slightly longer prompts don't need a new context
+    contextParameters.n_ctx = (requiredContextSize + contextSizeGranularity - 1) / contextSizeGranularity * contextSizeGranularity; // Set the context size
+    contextParameters.n_batch = contextParameters.n_ctx; // Set the maximum number of tokens that can be processed in a single call to llama_decode
     contextParameters.no_perf = false; // Enable performance counters
 
-    // Initialize the context
-    ctx = llama_init_from_model(model, contextParameters);
+    // Give back the previous prompt's context so that it can be reused
+    ctx = nullptr;
+    cachedTokens.clear();
+
+    // Check a context out of the pool (a new one is made if there isn't a suitable one)
+    ctx = LLMModelRegistry::Get()->AcquireContext(model, contextParameters);
 
     if (ctx == nullptr)
     {
         fprintf(stderr, "%s: error: failed to create the llama_context\n", __func__);
     }
 }
+
+int SimpleLLM::ReuseCachedPrefix()
+{
+    const auto memory = llama_get_memory(ctx.get());
+
+    // Encoder-decoder models re-encode the whole prompt each time, so there is nothing to reuse
+    if (llama_model_has_encoder(model.get()) || prompt_tokens.empty())
+    {
+        llama_memory_clear(memory, true);
+        cachedTokens.clear();
+        return 0;
+    }
+
+    // Find out how much of the new prompt has already been evaluated (i.e. a shared preamble)
+    auto n_past = common_lcp(cachedTokens, prompt_tokens);
+
+    // The last prompt token always needs to be decoded so that we have logits to sample the first prediction from
+    if (n_past >= prompt_tokens.size())
+    {
+        n_past = prompt_tokens.size() - 1;
+    }
+
+    // Throw away whatever was evaluated after the shared prefix
+    if (!llama_memory_seq_rm(memory, 0, static_cast<llama_pos>(n_past), -1))
+    {
+        llama_memory_clear(memory, true);
+        n_past = 0;
+    }
+
+    cachedTokens.resize(n_past);
+
+    return static_cast<int>(n_past);
+}
+
+int SimpleLLM::RestoreSession(const std::string &sessionPath)
+{
+    const auto restored = LLMSessionFile::Restore(sessionPath, ctx.get(), 0, modelHash, prompt_tokens);
+
+    if (restored == 0)
+    {
+        return 0;
+    }
+
+    // The last prompt token always needs to be decoded so that we have logits to sample the first prediction from
+    const auto n_past = std::min(restored, prompt_tokens.size() - 1);
+
+    llama_memory_seq_rm(llama_get_memory(ctx.get()), 0, static_cast<llama_pos>(n_past), -1);
+    cachedTokens.assign(prompt_tokens.begin(), prompt_tokens.begin() + static_cast<std::ptrdiff_t>(n_past));
+
+    return static_cast<int>(n_past);
+}
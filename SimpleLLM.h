@@ -1,9 +1,20 @@
 #pragma once
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 #include "llama.h"
 #include <iostream>
 
+#include "common.h"
+#include "InferenceStats.h"
+#include "LLMSessionFile.h"
+#include "sampling.h"
+#include "StructuredOutput.h"
+#include "TokenStream.h"
 
 
 class SimpleLLM
@@ -22,17 +33,83 @@ public:
 	 */
 	std::string Infer(const std::string &userPrompt, int n_predict);
 
+	/**
+	 * Only lets the LLM answer with what output's grammar allows and stops as soon as the answer is complete
+	 * @param userPrompt prompt to generate the answer from
+	 * @param output what the answer looks like and how to parse it, e.g. NpcDecisions::NextDirection()
+	 * @param n_predict most tokens to predict, nothing is returned if the answer isn't complete by then
+	 */
+	template <typename T>
+	std::optional<T> InferStructured(const std::string &userPrompt, const StructuredOutput<T> &output, const int n_predict = 32)
+	{
+		std::optional<T> result;
+
+		Generate(userPrompt, n_predict, GetGrammarSampler(output.grammar), [&](const std::string_view response)
+		{
+			result = output.parse(response);
+			return result.has_value();
+		});
+
+		return result;
+	}
+
+	/**
+	 * @param parameters how tokens are picked, otherwise the "sampling" settings are used
+	 */
+	void SetSamplingParameters(const common_params_sampling &parameters);
+
+	/**
+	 * @param directory where evaluated prompts are saved, a prompt that has been seen before (even on a previous run)
+	 * is restored from here instead of being evaluated again. Empty turns this off.
+	 * @param maxBytes the least recently used sessions are deleted to keep the directory within this
+	 */
+	void SetSessionDirectory(const std::string &directory, uint64_t maxBytes = LLMSessionFile::defaultMaxDirectoryBytes);
+
+	// Timings and token counts from the last call to Infer or InferStructured
+	[[nodiscard]] const InferenceStats& GetLastStats() const { return lastStats; }
+
 
 private:
-	llama_sampler* smpl {};
-    llama_context* ctx {};
-    llama_model* model {};
+	// Built once and reset for each prompt
+	std::shared_ptr<common_sampler> sampler {};
+	std::unordered_map<std::string, std::shared_ptr<common_sampler>> grammarSamplers {}; // keyed by grammar
+	common_params_sampling samplingParameters {};
+	bool useSamplingSettings = true;
+    std::shared_ptr<llama_context> ctx {};
+    std::shared_ptr<llama_model> model {};
     const llama_vocab* vocab {};
 	bool initialized = false;
 	std::vector<llama_token> prompt_tokens;
 	int numTokensInPrompt {0};
 
+	TokenDecoder tokenDecoder;
+
+	// Tokens whose evaluated state is currently held in the context's KV cache (sequence 0)
+	std::vector<llama_token> cachedTokens;
+
+	InferenceStats lastStats {};
+
+	// Saved prompt states, see LLMSessionFile
+	std::string sessionDirectory;
+	uint64_t maxSessionBytes = LLMSessionFile::defaultMaxDirectoryBytes;
+	uint64_t modelHash = 0;
+
+	// Contexts are sized in multiples of this so that they can be kept across prompts of slightly different lengths
+	static constexpr uint32_t contextSizeGranularity = 256;
+
 	void InitializeModel(const std::string &modelPath, const int ngl);
 	void InitializeContext(const std::string &userPrompt, const int n_predict);
+	void InitializeSampler();
+	common_sampler* GetGrammarSampler(const std::string &grammar);
+
+	// Stops early when isComplete (if set) returns true for the response so far
+	std::string Generate(const std::string &userPrompt, int n_predict, common_sampler* tokenSampler,
+	                     const std::function<bool(std::string_view response)> &isComplete);
+
+	// Drops the cached tokens that the new prompt does not share and returns how many prompt tokens can be skipped
+	int ReuseCachedPrefix();
+
+	// Restores the prompt's state from the session directory (if it is there) and returns how many tokens can be skipped
+	int RestoreSession(const std::string &sessionPath);
 };
 
@@ -0,0 +1,78 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_SPSCQUEUE_H
+#define GAME3_SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Fixed size, lock-free queue for exactly one producer thread and one consumer thread. Nothing is allocated after
+ * construction; pushing to a full queue fails rather than growing it.
+ * @tparam Capacity must be a power of two
+ */
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer only. Returns false if the queue is full.
+    bool TryPush(const T &value)
+    {
+        const size_t write = writeIndex.load(std::memory_order_relaxed);
+
+        if (write - readIndex.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        items[write & (Capacity - 1)] = value;
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool TryPop(T &value)
+    {
+        const size_t read = readIndex.load(std::memory_order_relaxed);
+
+        if (read == writeIndex.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        value = items[read & (Capacity - 1)];
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] bool Empty() const
+    {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] size_t Size() const
+    {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+    }
+
+    // Only safe when neither thread is using the queue
+    void Clear()
+    {
+        readIndex.store(0, std::memory_order_relaxed);
+        writeIndex.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<T, Capacity> items {};
+
+    // On their own cache lines so the two threads don't fight over them
+    alignas(64) std::atomic<size_t> writeIndex {0};
+    alignas(64) std::atomic<size_t> readIndex {0};
+};
+
+#endif //GAME3_SPSCQUEUE_H
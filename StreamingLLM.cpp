@@ -7,8 +7,13 @@
 #include "common.h"
 #include <file/SettingsManager.h>
 
+#include "EmbeddingCacheFile.h"
+#include "LLMMetrics.h"
+#include "LLMModelRegistry.h"
+#include "LLMSessionFile.h"
 #include "LLMPredctionCompleteEvent.h"
 #include "LLMTokenPredictedReceived.h"
+#include "SamplingSettings.h"
 #ifdef _WIN32
 #include <io.h>
 #define dup2 _dup2
@@ -22,24 +27,47 @@
 #include <iostream>
 
 
-StreamingLLM::StreamingLLM(std::string eos) : answerEOS(std::move(eos))
+StreamingLLM::StreamingLLM(std::string eos, const bool runAsync) : answerEOS(std::move(eos)), runAsync(runAsync)
 {
     settingsManager = gamelib::SettingsManager::Get();
 }
 
 void StreamingLLM::Initialize(const std::string &prompt, const uint32_t n_predict)
 {
+    // Wait for any previous prompt to stop using the context
+    StopInferenceThread();
+
+    // The last prompt may have been sampling with the old sampler until now
+    if (newSamplingParameters.has_value())
+    {
+        samplingParameters = *newSamplingParameters;
+        useSamplingSettings = false;
+        sampler = nullptr;
+        newSamplingParameters.reset();
+    }
+
+    if (newDraftSamplingParameters.has_value())
+    {
+        draftSamplingParameters = *newDraftSamplingParameters;
+        draftSampler = nullptr;
+        newDraftSamplingParameters.reset();
+    }
+
     // Set the user prompt
 
     LoadSettings();
 
     RunWithoutStdErrOutput([&]
     {
+        const auto previousModel = model;
+        const auto previousDraftModel = draftModel;
+
         auto modelParameters = llama_model_default_params();
 
         modelParameters.n_gpu_layers = 99;
 
-        model = llama_model_load_from_file(inferringLLMModelPath.c_str(), modelParameters);
+        // Share the model with anyone else that has already loaded it
+        model = LLMModelRegistry::Get()->AcquireModel(inferringLLMModelPath, modelParameters);
 
         if (model == nullptr)
         {
@@ -47,40 +75,233 @@ void StreamingLLM::Initialize(const std::string &prompt, const uint32_t n_predic
         }
 
         // Initialize vocab
-        vocab = llama_model_get_vocab(model);
+        vocab = llama_model_get_vocab(model.get());
+
+        // Saved sessions are only restored into the model that made them
+        modelHash = sessionDirectory.empty() ? 0 : EmbeddingCacheFile::HashModelFile(inferringLLMModelPath);
+
+        InitializeDraftModel();
+
+        // Samplers only need building again if the model has changed
+        if (model != previousModel) sampler = nullptr;
+        if (draftModel != previousDraftModel) draftSampler = nullptr;
 
         // Initialize context
         InitializeContext(prompt, n_predict);
     });
+
+    if (runAsync)
+    {
+        // Hand the prompt over to the inference thread, Update() will collect the tokens it produces
+        StartInferenceThread();
+    }
 }
 
-void StreamingLLM::InitializeContext(const std::string &prompt, const uint32_t n_predict)
+void StreamingLLM::StartInferenceThread()
 {
-    prompt_tokens.clear();
+    // Only one prompt can be in flight at a time
+    StopInferenceThread();
+
+    cancelRequested = false;
+    generationFinished = false;
+    completionRaised = false;
 
-    const uint32_t numTokensInPrompt = GetNumTokensInString(prompt);
+    // Drop anything left over from a cancelled prompt
+    predictedTokens.Clear();
 
-    prompt_tokens.resize(numTokensInPrompt);
+    // Allow a long running llama_decode (i.e. prompt evaluation) to be interrupted by Cancel()
+    llama_set_abort_callback(ctx.get(), IsCancelRequested, this);
 
-    if (llama_tokenize(vocab, prompt.c_str(), prompt.size(), prompt_tokens.data(), prompt_tokens.size(), true, true) < 0)
+    if (draftCtx != nullptr)
+    {
+        llama_set_abort_callback(draftCtx.get(), IsCancelRequested, this);
+    }
+
+    inferenceThread = std::thread([this]
+    {
+        Generate([this](const std::string_view token)
+        {
+            // Wait for the game thread to catch up if it has fallen a long way behind
+            while (!predictedTokens.Push(token) && !cancelRequested)
+            {
+                std::this_thread::yield();
+            }
+        });
+
+        generationFinished.store(true, std::memory_order_release);
+    });
+}
+
+void StreamingLLM::StopInferenceThread()
+{
+    if (inferenceThread.joinable())
+    {
+        cancelRequested = true;
+        inferenceThread.join();
+    }
+}
+
+bool StreamingLLM::IsCancelRequested(void *data)
+{
+    return static_cast<StreamingLLM*>(data)->cancelRequested;
+}
+
+void StreamingLLM::Cancel()
+{
+    cancelRequested = true;
+}
+
+bool StreamingLLM::IsGenerating() const
+{
+    // Finished has to be read first, once it is set no more tokens will be queued
+    const bool finished = generationFinished.load(std::memory_order_acquire);
+    return !finished || !predictedTokens.Empty();
+}
+
+bool StreamingLLM::IsInferenceFinished() const
+{
+    return generationFinished.load(std::memory_order_acquire);
+}
+
+void StreamingLLM::SetMaxTokensPerFrame(const uint32_t maxTokens)
+{
+    maxTokensPerFrameOverride = maxTokens;
+    maxTokensPerFrame = maxTokens;
+}
+
+void StreamingLLM::SetSpeculativeDecoding(const bool enabled)
+{
+    speculativeDecoding = enabled;
+}
+
+void StreamingLLM::SetDraftModel(const std::string &path, const common_params_sampling &draftSampling)
+{
+    // Like the main sampler, the draft's is only rebuilt by the next Initialize()
+    draftModelOverride = path;
+    newDraftSamplingParameters = draftSampling;
+}
+
+void StreamingLLM::SetSessions(const bool enabled)
+{
+    sessions = enabled;
+}
+
+void StreamingLLM::SetSamplingParameters(const common_params_sampling &parameters)
+{
+    // The inference thread may still be using the sampler, so it is only rebuilt by the next Initialize()
+    newSamplingParameters = parameters;
+}
+
+void StreamingLLM::InitializeSamplers()
+{
+    if (sampler == nullptr)
+    {
+        if (useSamplingSettings)
+        {
+            samplingParameters = SamplingSettings::Load();
+        }
+
+        sampler = std::shared_ptr<common_sampler>(common_sampler_init(model.get(), samplingParameters), common_sampler_free);
+    }
+
+    if (draftModel == nullptr)
+    {
+        draftSampler = nullptr;
+    }
+    else if (draftSampler == nullptr)
+    {
+        // The draft only needs its most likely guesses, the main model's sampler makes the real choice
+        common_params_sampling parameters;
+        parameters.top_k = 10;
+        parameters.samplers = { COMMON_SAMPLER_TYPE_TOP_K };
+
+        draftSampler = std::shared_ptr<common_sampler>(common_sampler_init(draftModel.get(), draftSamplingParameters.value_or(parameters)), common_sampler_free);
+    }
+}
+
+void StreamingLLM::InitializeDraftModel()
+{
+    draftModel = nullptr;
+
+    if (!speculativeDecoding || draftModelPath.empty() || llama_model_has_encoder(model.get()))
+    {
+        return;
+    }
+
+    auto modelParameters = llama_model_default_params();
+    modelParameters.n_gpu_layers = speculativeParameters.n_gpu_layers < 0 ? 99 : speculativeParameters.n_gpu_layers;
+
+    draftModel = LLMModelRegistry::Get()->AcquireModel(draftModelPath, modelParameters);
+
+    if (draftModel == nullptr)
+    {
+        fprintf(stderr, "%s: error: unable to load draft model, speculative decoding is off\n", __func__);
+        return;
+    }
+
+    if (!IsDraftModelCompatible())
+    {
+        fprintf(stderr, "%s: error: the draft model's vocab does not match the model's, speculative decoding is off\n", __func__);
+        draftModel = nullptr;
+    }
+}
+
+bool StreamingLLM::IsDraftModelCompatible() const
+{
+    // The draft's tokens are checked by the main model, so they must mean the same thing to both
+    const auto draftVocab = llama_model_get_vocab(draftModel.get());
+
+    return llama_vocab_type(vocab) == llama_vocab_type(draftVocab) &&
+           llama_vocab_n_tokens(vocab) == llama_vocab_n_tokens(draftVocab) &&
+           llama_vocab_bos(vocab) == llama_vocab_bos(draftVocab) &&
+           llama_vocab_eos(vocab) == llama_vocab_eos(draftVocab);
+}
+
+void StreamingLLM::InitializeContext(const std::string &prompt, const uint32_t n_predict)
+{
+    // One pass, into the last prompt's vector
+    if (!TokenizeText(vocab, prompt, prompt_tokens))
     {
         fprintf(stderr, "%s: error: failed to tokenize the prompt\n", __func__);
     }
 
+    const auto numTokensInPrompt = static_cast<uint32_t>(prompt_tokens.size());
+
     contextParameters = llama_context_default_params();
 
     contextParameters.n_ctx = numTokensInPrompt + n_predict - 1; // Set the context size (memory)
     contextParameters.n_batch = numTokensInPrompt; // Set the maximum number of tokens that can be processed in a single call to llama_decode
+    if (draftModel != nullptr)
+    {
+        // The last token and the draft are checked in one batch
+        contextParameters.n_batch = std::max<uint32_t>(numTokensInPrompt, speculativeParameters.n_max + 1);
+    }
     contextParameters.no_perf = false; // Enable performance counters
-    contextParameters.n_threads = 16;
 
-    // Initialize the context
-    ctx = llama_init_from_model(model, contextParameters);
+    // Give back the previous prompt's context so that it can be reused
+    ctx = nullptr;
+
+    // Check a context out of the pool (a new one is made if there isn't a suitable one)
+    ctx = LLMModelRegistry::Get()->AcquireContext(model, contextParameters);
 
     if (ctx == nullptr)
     {
         fprintf(stderr, "%s: error: failed to create the llama_context\n", __func__);
     }
+
+    // The draft model needs room for the same tokens
+    draftCtx = nullptr;
+    draftCachedTokens.clear();
+
+    if (draftModel != nullptr)
+    {
+        draftCtx = LLMModelRegistry::Get()->AcquireContext(draftModel, contextParameters);
+
+        if (draftCtx == nullptr)
+        {
+            fprintf(stderr, "%s: error: failed to create the draft llama_context\n", __func__);
+        }
+    }
 }
 
 gamelib::GameObjectType StreamingLLM::GetGameObjectType()
@@ -90,124 +311,448 @@ gamelib::GameObjectType StreamingLLM::GetGameObjectType()
 
 
 void StreamingLLM::Update(unsigned long deltaMs)
+{
+    if (runAsync)
+    {
+        // The inference thread does the heavy lifting, we just pass on what it has produced so far
+        RaisePredictedTokens();
+        return;
+    }
+
+    Generate([this](const std::string_view token)
+    {
+        ScopedLatency dispatching(LLMMetrics::Get().eventDispatchMs);
+        RaiseEvent(tokenEvents.Acquire(token));
+    });
+
+    RaiseEvent(std::make_shared<LLMPredictionCompleteEvent>());
+}
+
+void StreamingLLM::RaisePredictedTokens()
+{
+    if (completionRaised) return;
+
+    // Finished has to be read before the queue, once it is set no more tokens will be queued
+    const bool finished = generationFinished.load(std::memory_order_acquire);
+
+    // Take at most maxTokensPerFrame tokens so that a long answer is spread over a number of frames
+    std::string_view token;
+    for (uint32_t count = 0; (maxTokensPerFrame == 0 || count < maxTokensPerFrame) && predictedTokens.Pop(poppedToken, token); count++)
+    {
+        ScopedLatency dispatching(LLMMetrics::Get().eventDispatchMs);
+        RaiseEvent(tokenEvents.Acquire(token));
+    }
+
+    const bool isComplete = finished && predictedTokens.Empty();
+
+    if (isComplete)
+    {
+        RaiseEvent(std::make_shared<LLMPredictionCompleteEvent>());
+        completionRaised = true;
+    }
+}
+
+void StreamingLLM::Generate(const TokenCallback &onTokenPredicted)
 {
     uint32_t n_predict = contextParameters.n_ctx ;
 
+    generationStart = ggml_time_us();
+    lastStats = {};
+    LLMMetrics::Get().prompts.Add();
+
+    // Only builds the samplers the first time, after that they are just reset
+    InitializeSamplers();
+    common_sampler_reset(sampler.get());
+
     // print the prompt token-by-token
+    tokenDecoder.SetVocab(vocab);
+    tokenDecoder.Reset();
 
     for (const auto id : prompt_tokens)
     {
-        char buf[128];
-        const int n = llama_token_to_piece(vocab, id, buf, sizeof(buf), 0, true);
-        if (n < 0) {
-            fprintf(stderr, "%s: error: failed to convert token to piece\n", __func__);
-        }
-        std::string s(buf, n);
-        printf("%s", s.c_str());
-    }
+        const auto text = tokenDecoder.Decode(id);
+        fwrite(text.data(), 1, text.size(), stdout);
 
-    // Convert the prompt into a batch so the decoder can understand it
-    llama_batch batch = PromptToBatch();
+        // The prompt counts towards the repeat penalty
+        common_sampler_accept(sampler.get(), id, false);
+    }
 
-    const auto numTokensInPrompt = contextParameters.n_batch;
+    tokenDecoder.Reset();
 
-    // Initialize the sampler
-    auto samplerParameters = llama_sampler_chain_default_params();
+    if (draftCtx != nullptr)
+    {
+        GenerateWithDraft(onTokenPredicted);
+        return;
+    }
 
-    // Don't measure performance timing
-    samplerParameters.no_perf = false;
+    // A prompt that has been evaluated before (e.g. on a previous run) is restored rather than evaluated again
+    const auto sessionPath = GetSessionPath();
+    const int n_past = sessionPath.empty() ? 0 : RestoreSession(sessionPath);
+    auto saveSession = !sessionPath.empty() && n_past == 0;
 
-    llama_sampler * sampler = llama_sampler_chain_init(samplerParameters);
+    // Convert the (rest of the) prompt into a batch so the decoder can understand it
+    llama_batch batch = n_past > 0 ? llama_batch_get_one(prompt_tokens.data() + n_past, static_cast<int32_t>(prompt_tokens.size()) - n_past)
+                                   : PromptToBatch();
 
-    // Use the greedy sampler to always selects the highest probability token
-    llama_sampler_chain_add(sampler, llama_sampler_init_greedy());
+    const auto numTokensInPrompt = static_cast<uint32_t>(prompt_tokens.size());
 
     // main loop
 
+    auto &metrics = LLMMetrics::Get();
     const auto t_main_start = ggml_time_us();
     int n_decode = 0;
     llama_token new_token_id;
 
     // The context window represents the memory available for the attention mechanisms to work with
     // So you have the initial prompt tokens + how many you'd like to predict ie: (3) "My name is"  + (1) "Stuart"
-    for (int n_pos = 0; n_pos + batch.n_tokens < numTokensInPrompt + n_predict; )
+    for (int n_pos = n_past; n_pos + batch.n_tokens < numTokensInPrompt + n_predict; )
     {
+        // Stop early if we've been asked to
+        if (cancelRequested)
+        {
+            break;
+        }
+
         // Position 0 is the first prediction after the prompt
         // Position 1 is the second prediction after the prompt including the first prediction etc..
 
+        const auto t_decode_start = ggml_time_us();
+
         // Evaluate the current batch with the transformer model
-        if (llama_decode(ctx, batch))
+        if (llama_decode(ctx.get(), batch))
         {
             fprintf(stderr, "%s : failed to eval, return code %d\n", __func__, 1);
+            break;
+        }
+
+        const auto decodeMs = (ggml_time_us() - t_decode_start) / 1000.0;
+
+        // The first batch is (what wasn't restored of) the prompt
+        if (n_pos == n_past)
+        {
+            lastStats.promptTokens = batch.n_tokens;
+            lastStats.promptMs = (ggml_time_us() - t_main_start) / 1000.0;
+            metrics.promptEvalMs.Record(decodeMs);
+            metrics.promptTokens.Add(batch.n_tokens);
+        }
+        else
+        {
+            metrics.decodeMs.Record(decodeMs);
         }
 
         n_pos += batch.n_tokens; // normally first time batch is called, the same number of tokens in prompt is returned, then 1 token each time thereafter
 
-        // sample the next token
+        // Only the prompt has been evaluated so far, which is what the next run wants
+        if (saveSession)
         {
-            new_token_id = llama_sampler_sample(sampler, ctx, -1);
+            SaveSession(sessionPath, prompt_tokens);
+            saveSession = false;
+        }
 
-            // is it an end of generation?
-            if (llama_vocab_is_eog(vocab, new_token_id))
+        // sample the next token
+        {
             {
-                break;
+                ScopedLatency sampling(metrics.sampleMs);
+                new_token_id = common_sampler_sample(sampler.get(), ctx.get(), -1);
+                common_sampler_accept(sampler.get(), new_token_id, true);
             }
 
-            // Convert token to text
-            char buf[128];
-            const int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
-            if (n < 0)
+            if (!EmitToken(new_token_id, onTokenPredicted))
             {
-                fprintf(stderr, "%s: error: failed to convert token to piece\n", __func__);
+                break;
             }
 
-            std::string text(buf, n);
+            // prepare the next batch with the sampled token
+            batch = llama_batch_get_one(&new_token_id, 1);
+
+            n_decode += 1;
+        }
+    }
+
+    printf("\n");
+
+    const auto t_main_end = ggml_time_us();
+
+    lastStats.generatedTokens = n_decode;
+    lastStats.generationMs = (t_main_end - t_main_start) / 1000.0 - lastStats.promptMs;
+
+    metrics.generatedTokens.Add(n_decode);
+    metrics.generationTokensPerSecond.Set(lastStats.GenerationTokensPerSecond());
+}
+
+
+void StreamingLLM::GenerateWithDraft(const TokenCallback &onTokenPredicted)
+{
+    auto &metrics = LLMMetrics::Get();
+    const auto t_main_start = ggml_time_us();
+    const int n_ctx = static_cast<int>(llama_n_ctx(ctx.get()));
+    const auto memory = llama_get_memory(ctx.get());
+
+    // Evaluate all but the last prompt token, the last one is checked along with the first draft. Whatever was saved
+    // by a previous run doesn't need evaluating again.
+    const auto sessionPath = GetSessionPath();
+    const int restored = sessionPath.empty() ? 0 : RestoreSession(sessionPath);
+    int n_past = static_cast<int>(prompt_tokens.size()) - 1;
+
+    if (n_past > restored)
+    {
+        if (llama_decode(ctx.get(), llama_batch_get_one(prompt_tokens.data() + restored, n_past - restored)))
+        {
+            fprintf(stderr, "%s : failed to eval, return code %d\n", __func__, 1);
+            return;
+        }
+
+        lastStats.promptTokens = n_past - restored;
+        lastStats.promptMs = (ggml_time_us() - t_main_start) / 1000.0;
+        metrics.promptEvalMs.Record(lastStats.promptMs);
+        metrics.promptTokens.Add(lastStats.promptTokens);
+
+        if (!sessionPath.empty())
+        {
+            SaveSession(sessionPath, llama_tokens(prompt_tokens.begin(), prompt_tokens.end() - 1));
+        }
+    }
+
+    // The main model's sampler picks every token, so the answer is picked the same way as without a draft
+    llama_batch batch = llama_batch_init(speculativeParameters.n_max + 1, 0, 1);
+
+    // The draft model's first batch is the whole prompt
+    llama_batch draftBatch = llama_batch_init(static_cast<int32_t>(contextParameters.n_batch), 0, 1);
+
+    llama_tokens confirmed = prompt_tokens;
+    llama_token last = prompt_tokens.back();
+    int n_decode = 0;
+    int n_drafted = 0;
+    int n_accepted = 0;
+    bool finished = false;
+
+    while (!finished && !cancelRequested)
+    {
+        // Positions left for the draft after the last token
+        const int room = n_ctx - n_past - 1;
+
+        if (room < 0)
+        {
+            break;
+        }
+
+        const auto draft = Draft(confirmed, std::min(speculativeParameters.n_max, room), draftSampler.get(), draftBatch);
+
+        // Check the last token and the whole draft in one go
+        common_batch_clear(batch);
+        common_batch_add(batch, last, n_past, { 0 }, true);
+        for (size_t i = 0; i < draft.size(); i++)
+        {
+            common_batch_add(batch, draft[i], n_past + 1 + static_cast<int>(i), { 0 }, true);
+        }
+
+        {
+            ScopedLatency decoding(metrics.decodeMs);
 
-            if (text == answerEOS)
+            if (llama_decode(ctx.get(), batch))
             {
-                std::cout << "\nExplicit EOS character ("<< answerEOS << ") found in predicted token, completing generation.\n";
+                fprintf(stderr, "%s : failed to eval, return code %d\n", __func__, 1);
                 break;
             }
+        }
 
-            printf("%s", text.c_str());
-            fflush(stdout);
+        // The draft tokens the main model agrees with, plus the main model's own next token
+        llama_tokens accepted;
+        {
+            ScopedLatency sampling(metrics.sampleMs);
+            accepted = common_sampler_sample_and_accept_n(sampler.get(), ctx.get(), draft);
+        }
 
-            RaiseEvent(std::make_shared<LLMPredictedTokenReceivedEvent>(text));
+        n_drafted += static_cast<int>(draft.size());
+        n_accepted += static_cast<int>(accepted.size()) - 1;
+        n_past += static_cast<int>(accepted.size());
 
-            // prepare the next batch with the sampled token
-            batch = llama_batch_get_one(&new_token_id, 1);
+        for (const auto token : accepted)
+        {
+            if (!EmitToken(token, onTokenPredicted))
+            {
+                finished = true;
+                break;
+            }
 
+            confirmed.push_back(token);
             n_decode += 1;
         }
+
+        last = accepted.back();
+
+        // Forget the draft tokens that were rejected
+        llama_memory_seq_rm(memory, 0, n_past, -1);
     }
 
     printf("\n");
-    RaiseEvent(std::make_shared<LLMPredictionCompleteEvent>());
+
+    llama_batch_free(batch);
+    llama_batch_free(draftBatch);
 
     const auto t_main_end = ggml_time_us();
 
-    fprintf(stderr, "%s: decoded %d tokens in %.2f s, speed: %.2f t/s\n",
-            __func__, n_decode, (t_main_end - t_main_start) / 1000000.0f, n_decode / ((t_main_end - t_main_start) / 1000000.0f));
+    lastStats.generatedTokens = n_decode;
+    lastStats.generationMs = (t_main_end - t_main_start) / 1000.0 - lastStats.promptMs;
+
+    metrics.generatedTokens.Add(n_decode);
+    metrics.draftedTokens.Add(n_drafted);
+    metrics.acceptedDraftTokens.Add(n_accepted);
+    metrics.generationTokensPerSecond.Set(lastStats.GenerationTokensPerSecond());
+}
+
+llama_tokens StreamingLLM::Draft(const llama_tokens &confirmed, const int maxTokens, common_sampler* sampler, llama_batch &batch)
+{
+    llama_tokens draft;
+
+    if (maxTokens <= 0)
+    {
+        return draft;
+    }
+
+    const auto memory = llama_get_memory(draftCtx.get());
+
+    // Bring the draft's cache up to date with what has been confirmed, keeping what it already agrees with. The last
+    // confirmed token is always decoded as we need its logits.
+    const int reuse = std::min(static_cast<int>(common_lcp(draftCachedTokens, confirmed)), static_cast<int>(confirmed.size()) - 1);
+
+    llama_memory_seq_rm(memory, 0, reuse, -1);
+    draftCachedTokens.resize(reuse);
+
+    common_batch_clear(batch);
+    for (int i = reuse; i < static_cast<int>(confirmed.size()); i++)
+    {
+        common_batch_add(batch, confirmed[i], i, { 0 }, i == static_cast<int>(confirmed.size()) - 1);
+    }
+
+    common_sampler_reset(sampler);
+
+    while (static_cast<int>(draft.size()) < maxTokens)
+    {
+        if (llama_decode(draftCtx.get(), batch))
+        {
+            break;
+        }
+
+        for (int i = 0; i < batch.n_tokens; i++)
+        {
+            draftCachedTokens.push_back(batch.token[i]);
+        }
+
+        common_sampler_sample(sampler, draftCtx.get(), -1, true);
+        const auto* candidates = common_sampler_get_candidates(sampler, true);
+        const auto token = candidates->data[0].id;
+
+        common_sampler_accept(sampler, token, true);
+        draft.push_back(token);
+
+        // Only keep guessing while the draft model is confident, otherwise the guesses are likely to be rejected anyway
+        if (candidates->data[0].p < speculativeParameters.p_min || llama_vocab_is_eog(vocab, token))
+        {
+            break;
+        }
+
+        common_batch_clear(batch);
+        common_batch_add(batch, token, static_cast<int>(draftCachedTokens.size()), { 0 }, true);
+    }
+
+    return draft;
+}
+
+bool StreamingLLM::EmitToken(const llama_token token, const TokenCallback &onTokenPredicted)
+{
+    // is it an end of generation?
+    if (llama_vocab_is_eog(vocab, token))
+    {
+        return false;
+    }
+
+    // Convert token to text, this is empty if the token is only part of a character
+    std::string_view text;
+    {
+        ScopedLatency detokenizing(LLMMetrics::Get().detokenizeMs);
+        text = tokenDecoder.Decode(token);
+    }
+
+    if (text.empty())
+    {
+        return true;
+    }
+
+    if (text == answerEOS)
+    {
+        std::cout << "\nExplicit EOS character ("<< answerEOS << ") found in predicted token, completing generation.\n";
+        return false;
+    }
+
+    fwrite(text.data(), 1, text.size(), stdout);
+    fflush(stdout);
+
+    if (lastStats.firstTokenMs == 0)
+    {
+        lastStats.firstTokenMs = (ggml_time_us() - generationStart) / 1000.0;
+        LLMMetrics::Get().firstTokenMs.Record(lastStats.firstTokenMs);
+    }
+
+    onTokenPredicted(text);
+
+    return true;
+}
+
+std::string StreamingLLM::GetSessionPath() const
+{
+    // Encoder-decoder models encode the whole prompt each time, there is nothing worth saving
+    if (sessionDirectory.empty() || llama_model_has_encoder(model.get()))
+    {
+        return "";
+    }
 
-    fprintf(stderr, "\n");
+    return LLMSessionFile::PathFor(sessionDirectory, modelHash, prompt_tokens);
+}
+
+int StreamingLLM::RestoreSession(const std::string &sessionPath)
+{
+    const auto memory = llama_get_memory(ctx.get());
 
+    // The saved state goes into an empty sequence
+    llama_memory_seq_rm(memory, 0, -1, -1);
+
+    const auto restored = LLMSessionFile::Restore(sessionPath, ctx.get(), 0, modelHash, prompt_tokens);
+
+    if (restored == 0)
+    {
+        return 0;
+    }
 
+    // The last prompt token always needs to be decoded so that we have logits to sample the first prediction from
+    const auto n_past = std::min(restored, prompt_tokens.size() - 1);
+    llama_memory_seq_rm(memory, 0, static_cast<llama_pos>(n_past), -1);
+
+    return static_cast<int>(n_past);
 }
 
+void StreamingLLM::SaveSession(const std::string &sessionPath, const llama_tokens &tokens) const
+{
+    if (LLMSessionFile::Save(sessionPath, ctx.get(), 0, modelHash, tokens))
+    {
+        // Make room for it by dropping the sessions that haven't been used for longest
+        LLMSessionFile::Trim(sessionDirectory, maxSessionBytes, sessionPath);
+    }
+}
 
 llama_batch StreamingLLM::PromptToBatch()
 {
     auto batch = llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size());
 
-    if (llama_model_has_encoder(model))
+    if (llama_model_has_encoder(model.get()))
     {
         // This is an Encoder–decoder model (Whisper/T5)
-        if (llama_encode(ctx, batch))
+        if (llama_encode(ctx.get(), batch))
         {
             fprintf(stderr, "%s : failed to eval\n", __func__);
         }
 
-        auto decoder_start_token_id = llama_model_decoder_start_token(model);
+        auto decoder_start_token_id = llama_model_decoder_start_token(model.get());
 
         if (decoder_start_token_id == LLAMA_TOKEN_NULL)
         {
@@ -241,18 +786,19 @@ void StreamingLLM::LoadSettings()
 {
     inferringLLMModelPath = settingsManager->GetString("llm", "InferringLLMModelPath");
     embeddingModelPath = settingsManager->GetString("llm", "EmbeddingModelPath");
+    maxTokensPerFrame = maxTokensPerFrameOverride.value_or(settingsManager->GetInt("llm", "MaxTokensPerFrame"));
+    draftModelPath = draftModelOverride.empty() ? settingsManager->GetString("llm", "DraftModelPath") : draftModelOverride;
+    speculativeParameters.n_max = settingsManager->GetInt("llm", "DraftMaxTokens");
+    sessionDirectory = sessions ? settingsManager->GetString("llm", "SessionDirectory") : "";
+    maxSessionBytes = static_cast<uint64_t>(std::max(0, settingsManager->GetInt("llm", "MaxSessionMb"))) * 1024 * 1024;
 }
 
 StreamingLLM::~StreamingLLM()
 {
+    StopInferenceThread();
 }
 
 
-int32_t StreamingLLM::GetNumTokensInString(const std::string &prompt) const
-{
-    return -llama_tokenize(vocab, prompt.c_str(), prompt.size(), nullptr, 0, true, true);
-}
-
 void StreamingLLM::RunWithoutStdErrOutput(const std::function<void()> &func)
 {
     // Save original stderr
@@ -5,22 +5,68 @@
 #ifndef GAME3_STREAMINGLLM_H
 #define GAME3_STREAMINGLLM_H
 
+#include <atomic>
 #include <functional>
+#include <array>
+#include <optional>
+#include <string_view>
+#include <thread>
 
 #include "llama.h"
 #include <file/SettingsManager.h>
 #include <objects/GameObject.h>
 
 #include "common.h"
+#include "InferenceStats.h"
+#include "LLMPredictedTokenEventPool.h"
+#include "LLMSessionFile.h"
+#include "sampling.h"
+#include "TokenStream.h"
 
 
 class StreamingLLM : public gamelib::GameObject
 {
 public:
-    explicit StreamingLLM(std::string eos = ".");
+    /**
+     * @param eos text that marks the end of an answer
+     * @param runAsync if true, inference runs on a background thread and tokens are raised over several frames
+     */
+    explicit StreamingLLM(std::string eos = ".", bool runAsync = false);
 
     void Initialize(const std::string &prompt, uint32_t n_predict);
 
+    // Asks the inference thread to stop generating as soon as possible
+    void Cancel();
+
+    // True while the inference thread is still producing tokens (or tokens are waiting to be raised)
+    bool IsGenerating() const;
+
+    // True once the inference thread has queued its last token, the tokens may not all have been raised yet
+    [[nodiscard]] bool IsInferenceFinished() const;
+
+    // Limits how many predicted token events are raised per call to Update() when running asynchronously (0 is no
+    // limit), instead of "llm"/"MaxTokensPerFrame"
+    void SetMaxTokensPerFrame(uint32_t maxTokens);
+
+    // Turns speculative decoding with the draft model ("llm"/"DraftModelPath") on or off. It is on by default but
+    // only used when a draft model is set. Either way the answer is the same, the draft model just makes it quicker.
+    void SetSpeculativeDecoding(bool enabled);
+
+    // Drafts with this model instead of "llm"/"DraftModelPath" (empty goes back to the setting) and picks the draft's
+    // guesses with these parameters instead of taking its most likely tokens, from the next prompt on
+    void SetDraftModel(const std::string &path, const common_params_sampling &draftSampling);
+
+    // Turns saving and restoring evaluated prompts on or off. It is on by default but only used when "llm"/"SessionDirectory"
+    // is set.
+    void SetSessions(bool enabled);
+
+    // Changes how tokens are picked from the next prompt on, e.g. SamplingSettings::Load("grumpyNpc") for an NPC with
+    // its own personality. Without this the "sampling" settings are used.
+    void SetSamplingParameters(const common_params_sampling &parameters);
+
+    // Timings and token counts from the last prompt, only read this once IsGenerating() is false
+    [[nodiscard]] const InferenceStats& GetLastStats() const { return lastStats; }
+
     gamelib::GameObjectType GetGameObjectType() override ;
 
 
@@ -37,20 +83,77 @@ public:
     ~StreamingLLM() override;
     static void RunWithoutStdErrOutput(const std::function<void()> &func);
 private:
+    // Receives the text of each predicted token, only valid for the duration of the call
+    using TokenCallback = std::function<void(std::string_view token)>;
+
+    void Generate(const TokenCallback &onTokenPredicted);
+    void GenerateWithDraft(const TokenCallback &onTokenPredicted);
+    llama_tokens Draft(const llama_tokens &confirmed, int maxTokens, common_sampler* sampler, llama_batch &batch);
+    bool EmitToken(llama_token token, const TokenCallback &onTokenPredicted);
+    bool IsDraftModelCompatible() const;
+    void StartInferenceThread();
+    void StopInferenceThread();
+    void RaisePredictedTokens();
+    static bool IsCancelRequested(void *data);
     llama_batch PromptToBatch();
-    int32_t GetNumTokensInString(const std::string &userPrompt) const;
     void InitializeContext(const std::string &userPrompt, uint32_t n_predict);
+    void InitializeDraftModel();
+    void InitializeSamplers();
+    std::string GetSessionPath() const;
+    int RestoreSession(const std::string &sessionPath);
+    void SaveSession(const std::string &sessionPath, const llama_tokens &tokens) const;
 
     gamelib::SettingsManager* settingsManager = nullptr;
     std::string inferringLLMModelPath;
     std::string embeddingModelPath;
-    llama_model * model {};
-    llama_context * ctx {};
+    std::shared_ptr<llama_model> model {};
+    std::shared_ptr<llama_context> ctx {};
     const llama_vocab * vocab {};
     std::vector<llama_token> prompt_tokens;
     std::vector<std::string> promptHistory {};
     llama_context_params contextParameters {};
     std::string answerEOS;
+
+    // Asynchronous inference
+    bool runAsync = false;
+    uint32_t maxTokensPerFrame = 4;
+    std::optional<uint32_t> maxTokensPerFrameOverride; // used instead of the setting if set
+    std::thread inferenceThread;
+    TokenTextQueue predictedTokens; // inference thread -> game thread
+    std::array<char, TokenTextQueue::maxTokenLength> poppedToken {};
+    std::atomic<bool> cancelRequested {false};
+    std::atomic<bool> generationFinished {false};
+    bool completionRaised = true;
+
+    // Speculative decoding: a small draft model guesses the next few tokens and the main model checks them all in one
+    // decode, keeping the ones it agrees with
+    bool speculativeDecoding = true;
+    std::string draftModelPath;
+    std::string draftModelOverride; // used instead of the setting if not empty
+    std::optional<common_params_sampling> draftSamplingParameters; // without these the draft's top 10 tokens are taken
+    std::optional<common_params_sampling> newDraftSamplingParameters;
+    common_params_speculative speculativeParameters {};
+    std::shared_ptr<llama_model> draftModel {};
+    std::shared_ptr<llama_context> draftCtx {};
+    llama_tokens draftCachedTokens; // what is in the draft context's KV cache
+
+    // Evaluated prompts are saved here and restored instead of being evaluated again ("llm"/"SessionDirectory")
+    bool sessions = true;
+    std::string sessionDirectory;
+    uint64_t maxSessionBytes = LLMSessionFile::defaultMaxDirectoryBytes; // "llm"/"MaxSessionMb"
+    uint64_t modelHash = 0;
+
+    // Samplers are built once and reset for each prompt
+    common_params_sampling samplingParameters {};
+    bool useSamplingSettings = true;
+    std::optional<common_params_sampling> newSamplingParameters; // set by SetSamplingParameters(), used from the next prompt
+    std::shared_ptr<common_sampler> sampler {};
+    std::shared_ptr<common_sampler> draftSampler {};
+
+    TokenDecoder tokenDecoder;
+    LLMPredictedTokenEventPool tokenEvents;
+    InferenceStats lastStats {};
+    int64_t generationStart = 0;
 };
 
 #endif //GAME3_STREAMINGLLM_H
\ No newline at end of file
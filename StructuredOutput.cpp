@@ -0,0 +1,178 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "StructuredOutput.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace
+{
+    // GBNF rule names can only have letters, digits and dashes
+    std::string RuleName(const std::string &property)
+    {
+        std::string name = "value-";
+        for (const auto c : property)
+        {
+            name += std::isalnum(static_cast<unsigned char>(c)) ? c : '-';
+        }
+        return name;
+    }
+
+    void SkipWhitespace(std::string_view &text)
+    {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+        {
+            text.remove_prefix(1);
+        }
+    }
+
+    bool Consume(std::string_view &text, const std::string_view expected)
+    {
+        SkipWhitespace(text);
+        if (text.substr(0, expected.size()) != expected)
+        {
+            return false;
+        }
+        text.remove_prefix(expected.size());
+        return true;
+    }
+
+    // The values the grammar allows never contain quotes, so there is nothing to unescape
+    std::optional<std::string> ConsumeString(std::string_view &text)
+    {
+        if (!Consume(text, "\""))
+        {
+            return std::nullopt;
+        }
+
+        const auto end = text.find('"');
+        if (end == std::string_view::npos)
+        {
+            return std::nullopt;
+        }
+
+        std::string value(text.substr(0, end));
+        text.remove_prefix(end + 1);
+        return value;
+    }
+
+    std::optional<std::string> ConsumeInteger(std::string_view &text)
+    {
+        SkipWhitespace(text);
+
+        size_t length = !text.empty() && text.front() == '-' ? 1 : 0;
+        const auto digitsStart = length;
+        while (length < text.size() && std::isdigit(static_cast<unsigned char>(text[length])))
+        {
+            length++;
+        }
+
+        if (length == digitsStart)
+        {
+            return std::nullopt;
+        }
+
+        std::string value(text.substr(0, length));
+        text.remove_prefix(length);
+        return value;
+    }
+}
+
+std::string GbnfLiteral(const std::string_view text)
+{
+    std::string literal = "\"";
+    for (const auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            literal += '\\';
+        }
+        literal += c;
+    }
+    return literal + "\"";
+}
+
+JsonObjectGrammar& JsonObjectGrammar::Enum(const std::string &property, const std::vector<std::string> &values)
+{
+    properties.push_back({property, values, 0});
+    return *this;
+}
+
+JsonObjectGrammar& JsonObjectGrammar::Integer(const std::string &property, const int maxDigits)
+{
+    properties.push_back({property, {}, std::max(1, maxDigits)});
+    return *this;
+}
+
+std::string JsonObjectGrammar::ToGbnf() const
+{
+    std::string root = "root ::= \"{\" ws";
+    std::string rules;
+
+    for (size_t i = 0; i < properties.size(); i++)
+    {
+        const auto &property = properties[i];
+        const auto rule = RuleName(property.name);
+
+        if (i > 0)
+        {
+            root += " \",\" ws";
+        }
+        root += " " + GbnfLiteral("\"" + property.name + "\"") + " ws \":\" ws " + rule + " ws";
+
+        rules += rule + " ::= ";
+        if (property.values.empty())
+        {
+            rules += "\"-\"? [0-9]{1," + std::to_string(property.maxDigits) + "}";
+        }
+        else
+        {
+            for (size_t v = 0; v < property.values.size(); v++)
+            {
+                rules += (v > 0 ? " | " : "") + GbnfLiteral("\"" + property.values[v] + "\"");
+            }
+        }
+        rules += "\n";
+    }
+
+    // Whitespace is limited so that the LLM can't pad the answer out forever
+    return root + " \"}\"\n" + rules + "ws ::= [ \\t\\n]?\n";
+}
+
+std::optional<std::map<std::string, std::string>> JsonObjectGrammar::Parse(std::string_view text) const
+{
+    std::map<std::string, std::string> values;
+
+    if (!Consume(text, "{"))
+    {
+        return std::nullopt;
+    }
+
+    for (size_t i = 0; i < properties.size(); i++)
+    {
+        const auto &property = properties[i];
+
+        if ((i > 0 && !Consume(text, ",")) || ConsumeString(text) != property.name || !Consume(text, ":"))
+        {
+            return std::nullopt;
+        }
+
+        const auto value = property.values.empty() ? ConsumeInteger(text) : ConsumeString(text);
+
+        if (!value || (!property.values.empty() && std::find(property.values.begin(), property.values.end(), *value) == property.values.end()))
+        {
+            return std::nullopt;
+        }
+
+        values[property.name] = *value;
+    }
+
+    if (!Consume(text, "}"))
+    {
+        return std::nullopt;
+    }
+
+    return values;
+}
@@ -0,0 +1,64 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_STRUCTUREDOUTPUT_H
+#define GAME3_STRUCTUREDOUTPUT_H
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * What an LLM is allowed to answer with, as a GBNF grammar, and how to turn that answer into a T. The grammar keeps
+ * the LLM from producing anything that can't be parsed and lets generation stop as soon as Parse() succeeds.
+ */
+template <typename T>
+struct StructuredOutput
+{
+    std::string grammar;
+
+    // Nothing until the answer is complete
+    std::function<std::optional<T>(std::string_view text)> parse;
+};
+
+/**
+ * Builds the grammar for a flat JSON object, i.e. the part of JSON schema we need for NPC decisions:
+ * {"direction": "Up", "steps": 2}. Properties always come in the order they are added, and there is no free text, so
+ * the object is finished at its closing brace.
+ */
+class JsonObjectGrammar
+{
+public:
+    // The property's value is one of these strings
+    JsonObjectGrammar& Enum(const std::string &property, const std::vector<std::string> &values);
+
+    // The property's value is a whole number of up to maxDigits digits
+    JsonObjectGrammar& Integer(const std::string &property, int maxDigits = 6);
+
+    [[nodiscard]] std::string ToGbnf() const;
+
+    /**
+     * @return each property's value (strings without their quotes), nothing if the object isn't complete or isn't one
+     * that the grammar allows
+     */
+    [[nodiscard]] std::optional<std::map<std::string, std::string>> Parse(std::string_view text) const;
+
+private:
+    struct Property
+    {
+        std::string name;
+        std::vector<std::string> values; // empty for an integer
+        int maxDigits = 0;
+    };
+
+    std::vector<Property> properties;
+};
+
+// Quotes text as a GBNF literal
+std::string GbnfLiteral(std::string_view text);
+
+#endif //GAME3_STRUCTUREDOUTPUT_H
@@ -0,0 +1,69 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGBATCHPACKERTESTS_H
+#define GAME3_EMBEDDINGBATCHPACKERTESTS_H
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+#include "EmbeddingBatchPacker.h"
+
+using namespace testing;
+
+class EmbeddingBatchPackerTests : public testing::Test
+{
+};
+
+TEST_F(EmbeddingBatchPackerTests, TestEveryInputIsPackedOnceWithinLimits)
+{
+    const std::vector<int> lengths = { 300, 20, 250, 500, 12, 200, 40, 180, 7, 90 };
+
+    const auto batches = EmbeddingBatchPacker::Pack(lengths, 512, 3);
+
+    std::vector<int> packed;
+    for (const auto &batch : batches)
+    {
+        int tokens = 0;
+        for (const auto input : batch)
+        {
+            tokens += lengths[input];
+            packed.push_back(input);
+        }
+
+        EXPECT_LE(tokens, 512);
+        EXPECT_LE(batch.size(), 3u);
+    }
+
+    std::sort(packed.begin(), packed.end());
+    EXPECT_EQ(packed, std::vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }));
+}
+
+TEST_F(EmbeddingBatchPackerTests, TestMixedLengthsNeedFewerBatchesThanInputOrder)
+{
+    // In order these need a batch each, as each long input is followed by one that doesn't fit with it
+    const std::vector<int> lengths = { 400, 300, 400, 300, 100, 100, 200, 200 };
+
+    const auto batches = EmbeddingBatchPacker::Pack(lengths, 512, 64);
+
+    EXPECT_EQ(batches.size(), 4u);
+}
+
+TEST_F(EmbeddingBatchPackerTests, TestLongInputsAreChunkedEvenly)
+{
+    EXPECT_EQ(EmbeddingBatchPacker::Chunk(10, 4), (std::vector<std::pair<int, int>>{ {0, 3}, {3, 6}, {6, 10} }));
+    EXPECT_EQ(EmbeddingBatchPacker::Chunk(4, 4), (std::vector<std::pair<int, int>>{ {0, 4} }));
+    EXPECT_TRUE(EmbeddingBatchPacker::Chunk(0, 4).empty());
+
+    for (const auto &[begin, end] : EmbeddingBatchPacker::Chunk(1300, 512))
+    {
+        EXPECT_LE(end - begin, 512);
+    }
+}
+
+
+
+
+#endif
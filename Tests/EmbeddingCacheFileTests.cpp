@@ -0,0 +1,166 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGCACHEFILETESTS_H
+#define GAME3_EMBEDDINGCACHEFILETESTS_H
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "EmbeddingCacheFile.h"
+
+using namespace testing;
+
+class EmbeddingCacheFileTests : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        path = (std::filesystem::temp_directory_path() / "game3_embedding_cache_test.bin").string();
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+    }
+
+    // A recognisable embedding for each text number
+    static std::vector<float> MakeEmbedding(const int i, const int n_embd)
+    {
+        std::vector<float> embedding(n_embd);
+        for (int j = 0; j < n_embd; j++)
+        {
+            embedding[j] = static_cast<float>(i) + static_cast<float>(j) / n_embd;
+        }
+        return embedding;
+    }
+
+    std::string path;
+};
+
+TEST_F(EmbeddingCacheFileTests, TestEmbeddingsSurviveReopeningAndGrowing)
+{
+    constexpr int n_embd = 384;
+    constexpr int count = 3000;
+    const uint64_t modelHash = 1234;
+
+    {
+        EmbeddingCacheFile file;
+        ASSERT_TRUE(file.Open(path, modelHash, n_embd, 2, 16));
+        EXPECT_EQ(file.Size(), 0u);
+        EXPECT_EQ(file.Find("room 0"), nullptr);
+
+        for (int i = 0; i < count; i++)
+        {
+            EXPECT_TRUE(file.Insert("room " + std::to_string(i), MakeEmbedding(i, n_embd).data()));
+        }
+
+        // Inserting the same text again doesn't add a row
+        EXPECT_TRUE(file.Insert("room 0", MakeEmbedding(0, n_embd).data()));
+        EXPECT_EQ(file.Size(), static_cast<size_t>(count));
+        EXPECT_GE(file.GetCapacity(), static_cast<size_t>(count));
+    }
+
+    EmbeddingCacheFile file;
+    ASSERT_TRUE(file.Open(path, modelHash, n_embd, 2));
+    EXPECT_EQ(file.Size(), static_cast<size_t>(count));
+
+    for (const int i : { 0, 1, 15, 16, 17, 1000, count - 1 })
+    {
+        const float* embedding = file.Find("room " + std::to_string(i));
+        ASSERT_NE(embedding, nullptr);
+
+        // Rows are aligned for SIMD loads
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(embedding) % 64, 0u);
+
+        const auto expected = MakeEmbedding(i, n_embd);
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), embedding));
+    }
+
+    EXPECT_EQ(file.Find("room " + std::to_string(count)), nullptr);
+}
+
+TEST_F(EmbeddingCacheFileTests, TestFileIsDiscardedWhenTheModelChanges)
+{
+    constexpr int n_embd = 8;
+
+    {
+        EmbeddingCacheFile file;
+        ASSERT_TRUE(file.Open(path, 1, n_embd, 2));
+        file.Insert("a dark room", MakeEmbedding(1, n_embd).data());
+    }
+
+    {
+        // Same model, still there
+        EmbeddingCacheFile file;
+        ASSERT_TRUE(file.Open(path, 1, n_embd, 2));
+        EXPECT_NE(file.Find("a dark room"), nullptr);
+    }
+
+    {
+        // Different normalisation
+        EmbeddingCacheFile file;
+        ASSERT_TRUE(file.Open(path, 1, n_embd, 0));
+        EXPECT_EQ(file.Find("a dark room"), nullptr);
+        file.Insert("a dark room", MakeEmbedding(1, n_embd).data());
+    }
+
+    {
+        // Different model
+        EmbeddingCacheFile file;
+        ASSERT_TRUE(file.Open(path, 2, n_embd, 0));
+        EXPECT_EQ(file.Size(), 0u);
+        EXPECT_EQ(file.Find("a dark room"), nullptr);
+    }
+}
+
+TEST_F(EmbeddingCacheFileTests, TestDamagedFileIsDiscarded)
+{
+    constexpr int n_embd = 8;
+
+    {
+        EmbeddingCacheFile file;
+        ASSERT_TRUE(file.Open(path, 1, n_embd, 2, 4));
+        file.Insert("a dark room", MakeEmbedding(1, n_embd).data());
+    }
+
+    // More rows than there is room for (the row count follows the magic, version, n_embd, normalisation and model hash)
+    {
+        std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+        const uint64_t rowCount = 1000;
+        stream.seekp(32);
+        stream.write(reinterpret_cast<const char*>(&rowCount), sizeof(rowCount));
+    }
+
+    EmbeddingCacheFile file;
+    ASSERT_TRUE(file.Open(path, 1, n_embd, 2, 4));
+    EXPECT_EQ(file.Size(), 0u);
+    EXPECT_EQ(file.Find("a dark room"), nullptr);
+}
+
+TEST_F(EmbeddingCacheFileTests, TestModelHashChangesWithTheModelFile)
+{
+    const auto modelPath = (std::filesystem::temp_directory_path() / "game3_embedding_model_test.gguf").string();
+
+    std::ofstream(modelPath) << "model one";
+    const auto first = EmbeddingCacheFile::HashModelFile(modelPath);
+    EXPECT_EQ(EmbeddingCacheFile::HashModelFile(modelPath), first);
+
+    std::ofstream(modelPath) << "a bigger model two";
+    EXPECT_NE(EmbeddingCacheFile::HashModelFile(modelPath), first);
+
+    EXPECT_NE(EmbeddingCacheFile::HashModelFile(modelPath + ".other"), first);
+
+    std::filesystem::remove(modelPath);
+}
+
+
+
+
+#endif
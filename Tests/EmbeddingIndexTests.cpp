@@ -0,0 +1,258 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_EMBEDDINGINDEXTESTS_H
+#define GAME3_EMBEDDINGINDEXTESTS_H
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "EmbeddingIndex.h"
+#include "VectorKernels.h"
+
+using namespace testing;
+
+class EmbeddingIndexTests : public testing::Test
+{
+public:
+    // Unit length random vectors, like the ones EmbeddingLLM produces
+    static std::vector<float> RandomEmbeddings(const int count, const int n_embd, const unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::normal_distribution<float> distribution;
+        std::vector<float> embeddings(static_cast<size_t>(count) * n_embd);
+
+        for (int i = 0; i < count; i++)
+        {
+            float* row = embeddings.data() + static_cast<size_t>(i) * n_embd;
+            float norm = 0;
+            for (int j = 0; j < n_embd; j++)
+            {
+                row[j] = distribution(random);
+                norm += row[j] * row[j];
+            }
+            norm = std::sqrt(norm);
+            for (int j = 0; j < n_embd; j++)
+            {
+                row[j] /= norm;
+            }
+        }
+
+        return embeddings;
+    }
+};
+
+TEST_F(EmbeddingIndexTests, TestKernelsMatchScalarDotProduct)
+{
+    // Odd length so the SIMD loops have a remainder to deal with
+    constexpr int n = 389;
+    const auto a = RandomEmbeddings(1, n, 1);
+    const auto b = RandomEmbeddings(1, n, 2);
+
+    double expected = 0;
+    for (int i = 0; i < n; i++)
+    {
+        expected += a[i] * b[i];
+    }
+
+    EXPECT_NEAR(DotF32(a.data(), b.data(), n), expected, 1e-5);
+
+    std::vector<int8_t> quantised(n);
+    const float scale = QuantiseInt8(b.data(), quantised.data(), n);
+
+    double expectedQuantised = 0;
+    for (int i = 0; i < n; i++)
+    {
+        expectedQuantised += a[i] * quantised[i];
+    }
+
+    EXPECT_NEAR(DotF32I8(a.data(), quantised.data(), n), expectedQuantised, 1e-3);
+
+    // Quantisation only loses a little
+    EXPECT_NEAR(DotF32I8(a.data(), quantised.data(), n) * scale, expected, 1e-2);
+}
+
+TEST_F(EmbeddingIndexTests, TestIntegerKernelsMatchScalarLoops)
+{
+    // Not a multiple of any SIMD width, so the tail is used too
+    constexpr int n = 389;
+    const auto a = RandomEmbeddings(1, n, 5);
+    const auto b = RandomEmbeddings(1, n, 6);
+
+    std::vector<int8_t> qa(n), qb(n);
+    QuantiseInt8(a.data(), qa.data(), n);
+    QuantiseInt8(b.data(), qb.data(), n);
+
+    int32_t expectedDot = 0;
+    for (int i = 0; i < n; i++)
+    {
+        expectedDot += qa[i] * qb[i];
+    }
+    EXPECT_EQ(DotI8(qa.data(), qb.data(), n), expectedDot);
+
+    std::vector<uint64_t> ba((n + 63) / 64), bb((n + 63) / 64);
+    const float scale = QuantiseBinary(a.data(), ba.data(), n);
+    QuantiseBinary(b.data(), bb.data(), n);
+
+    int expectedDistance = 0;
+    float sumAbs = 0;
+    for (int i = 0; i < n; i++)
+    {
+        expectedDistance += (a[i] > 0) != (b[i] > 0);
+        sumAbs += std::fabs(a[i]);
+    }
+    EXPECT_EQ(HammingDistance(ba.data(), bb.data(), static_cast<int>(ba.size())), expectedDistance);
+    EXPECT_NEAR(scale, sumAbs / n, 1e-6);
+}
+
+TEST_F(EmbeddingIndexTests, TestSearchReturnsBestMatchesFirst)
+{
+    constexpr int n_embd = 384;
+    constexpr int count = 1000;
+    const auto embeddings = RandomEmbeddings(count, n_embd, 3);
+
+    EmbeddingIndex index(n_embd);
+    EXPECT_EQ(index.AddAll(embeddings.data(), count), 0);
+    EXPECT_EQ(index.Size(), count);
+
+    // A stored vector is its own best match
+    const float* query = embeddings.data() + static_cast<size_t>(42) * n_embd;
+    const auto matches = index.Search(query, 5);
+
+    ASSERT_EQ(matches.size(), 5u);
+    EXPECT_EQ(matches[0].id, 42);
+    EXPECT_NEAR(matches[0].score, 1.0f, 1e-5);
+
+    // Same as scoring everything and sorting
+    std::vector<EmbeddingMatch> all;
+    for (int id = 0; id < count; id++)
+    {
+        all.push_back({id, index.Score(query, id)});
+    }
+    std::sort(all.begin(), all.end(), [](const EmbeddingMatch &a, const EmbeddingMatch &b) { return a.score > b.score; });
+
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        EXPECT_EQ(matches[i].id, all[i].id);
+        EXPECT_FLOAT_EQ(matches[i].score, all[i].score);
+    }
+
+    // Asking for more than there are gives back everything
+    EXPECT_EQ(index.Search(query, count + 10).size(), static_cast<size_t>(count));
+    EXPECT_TRUE(index.Search(query, 0).empty());
+}
+
+TEST_F(EmbeddingIndexTests, TestInt8IndexUsesQuarterOfMemoryAndFindsSameBestMatch)
+{
+    constexpr int n_embd = 384;
+    constexpr int count = 500;
+    const auto embeddings = RandomEmbeddings(count, n_embd, 4);
+
+    EmbeddingIndex exact(n_embd);
+    EmbeddingIndex quantised(n_embd, EmbeddingStorage::Int8);
+    exact.AddAll(embeddings.data(), count);
+    quantised.AddAll(embeddings.data(), count);
+
+    // The int8 vectors plus one float scale each
+    EXPECT_EQ(quantised.GetMemoryUsage(), static_cast<size_t>(count) * (n_embd + sizeof(float)));
+    EXPECT_LT(quantised.GetMemoryUsage() * 3, exact.GetMemoryUsage());
+
+    for (const int id : { 0, 17, 250, 499 })
+    {
+        const float* query = embeddings.data() + static_cast<size_t>(id) * n_embd;
+        const auto matches = quantised.Search(query, 1);
+
+        ASSERT_EQ(matches.size(), 1u);
+        EXPECT_EQ(matches[0].id, id);
+        EXPECT_NEAR(matches[0].score, exact.Score(query, id), 1e-2);
+
+        // Scoring one vector leaves the query as floats
+        EXPECT_NEAR(quantised.Score(query, 42), exact.Score(query, 42), 1e-2);
+    }
+
+    quantised.Clear();
+    EXPECT_EQ(quantised.Size(), 0);
+    EXPECT_EQ(quantised.GetMemoryUsage(), 0u);
+}
+
+
+TEST_F(EmbeddingIndexTests, TestBinaryIndexIsSmallAndRerankingRestoresExactScores)
+{
+    constexpr int n_embd = 384;
+    constexpr int count = 500;
+    const auto embeddings = RandomEmbeddings(count, n_embd, 7);
+
+    EmbeddingIndex exact(n_embd);
+    EmbeddingIndex binary(n_embd, EmbeddingStorage::Binary);
+    exact.AddAll(embeddings.data(), count);
+    binary.AddAll(embeddings.data(), count);
+
+    // Six words of bits plus one float scale each
+    EXPECT_EQ(binary.GetMemoryUsage(), static_cast<size_t>(count) * (6 * sizeof(uint64_t) + sizeof(float)));
+    EXPECT_LT(binary.GetMemoryUsage() * 20, exact.GetMemoryUsage());
+
+    for (const int id : { 0, 17, 250, 499 })
+    {
+        const float* query = embeddings.data() + static_cast<size_t>(id) * n_embd;
+
+        // A vector's own bits match exactly, so it is still the best match
+        EXPECT_EQ(binary.Search(query, 1)[0].id, id);
+
+        const auto expected = exact.Search(query, 5);
+        const auto reranked = binary.SearchAndRerank(query, 5, 100, embeddings.data());
+
+        ASSERT_EQ(reranked.size(), 5u);
+        EXPECT_EQ(reranked[0].id, id);
+        for (size_t i = 0; i < reranked.size(); i++)
+        {
+            EXPECT_EQ(reranked[i].score, exact.Score(query, reranked[i].id));
+            EXPECT_GE(reranked[i].score, expected.back().score - 0.1f);
+        }
+    }
+}
+
+TEST_F(EmbeddingIndexTests, TestQuantisedIndexCanBeSearchedFromSeveralThreads)
+{
+    constexpr int n_embd = 384;
+    constexpr int count = 200;
+    const auto embeddings = RandomEmbeddings(count, n_embd, 8);
+
+    for (const auto storage : { EmbeddingStorage::Int8, EmbeddingStorage::Binary })
+    {
+        EmbeddingIndex index(n_embd, storage);
+        index.AddAll(embeddings.data(), count);
+
+        // Each thread looks for different vectors at the same time, each should still find its own
+        std::vector<int> found(count, -1);
+        std::vector<std::thread> threads;
+        for (int thread = 0; thread < 4; thread++)
+        {
+            threads.emplace_back([&, thread]()
+            {
+                for (int id = thread; id < count; id += 4)
+                {
+                    found[id] = index.Search(embeddings.data() + static_cast<size_t>(id) * n_embd, 1)[0].id;
+                }
+            });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        for (int id = 0; id < count; id++)
+        {
+            EXPECT_EQ(found[id], id);
+        }
+    }
+}
+
+
+
+#endif
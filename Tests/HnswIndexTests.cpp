@@ -0,0 +1,127 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_HNSWINDEXTESTS_H
+#define GAME3_HNSWINDEXTESTS_H
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "HnswIndex.h"
+
+using namespace testing;
+
+class HnswIndexTests : public testing::Test
+{
+public:
+    // Unit length vectors scattered around a few clusters, a bit like embeddings of related descriptions
+    static std::vector<float> ClusteredEmbeddings(const int count, const int n_embd, const unsigned seed)
+    {
+        std::mt19937 random(seed);
+        std::normal_distribution<float> distribution;
+
+        constexpr int clusters = 20;
+        std::vector<float> centres(static_cast<size_t>(clusters) * n_embd);
+        for (auto &value : centres)
+        {
+            value = distribution(random);
+        }
+
+        std::vector<float> embeddings(static_cast<size_t>(count) * n_embd);
+        for (int i = 0; i < count; i++)
+        {
+            const float* centre = centres.data() + static_cast<size_t>(i % clusters) * n_embd;
+            float* row = embeddings.data() + static_cast<size_t>(i) * n_embd;
+            float norm = 0;
+            for (int j = 0; j < n_embd; j++)
+            {
+                row[j] = centre[j] + 0.5f * distribution(random);
+                norm += row[j] * row[j];
+            }
+            norm = std::sqrt(norm);
+            for (int j = 0; j < n_embd; j++)
+            {
+                row[j] /= norm;
+            }
+        }
+
+        return embeddings;
+    }
+
+    // Fraction of the exact top k that the approximate search also found
+    static double Recall(const HnswIndex &index, const std::vector<float> &queries, const int n_queries, const int k)
+    {
+        int found = 0;
+        for (int q = 0; q < n_queries; q++)
+        {
+            const float* query = queries.data() + static_cast<size_t>(q) * index.GetDimensions();
+            const auto exact = index.GetStore().Search(query, k);
+            const auto approximate = index.Search(query, k);
+
+            for (const auto &match : exact)
+            {
+                found += std::any_of(approximate.begin(), approximate.end(), [&](const EmbeddingMatch &m) { return m.id == match.id; });
+            }
+        }
+
+        return static_cast<double>(found) / (n_queries * k);
+    }
+};
+
+TEST_F(HnswIndexTests, TestIncrementalInsertsAreSearchable)
+{
+    constexpr int n_embd = 32;
+    constexpr int count = 500;
+    const auto embeddings = ClusteredEmbeddings(count, n_embd, 1);
+
+    HnswIndex index(n_embd);
+    EXPECT_TRUE(index.Search(embeddings.data(), 1).empty());
+
+    for (int i = 0; i < count; i++)
+    {
+        EXPECT_EQ(index.Add(embeddings.data() + static_cast<size_t>(i) * n_embd), i);
+
+        // The newest vector can be found straight away
+        const auto matches = index.Search(embeddings.data() + static_cast<size_t>(i) * n_embd, 1);
+        ASSERT_EQ(matches.size(), 1u);
+        EXPECT_EQ(matches[0].id, i);
+    }
+
+    EXPECT_EQ(index.Size(), count);
+}
+
+TEST_F(HnswIndexTests, TestParallelBuildHasHighRecall)
+{
+    constexpr int n_embd = 64;
+    constexpr int count = 5000;
+    constexpr int k = 10;
+    const auto embeddings = ClusteredEmbeddings(count, n_embd, 2);
+    const auto queries = ClusteredEmbeddings(100, n_embd, 3);
+
+    HnswIndex index(n_embd, { .M = 16, .efConstruction = 100, .efSearch = 64 });
+    EXPECT_EQ(index.AddAll(embeddings.data(), count, 4), 0);
+    EXPECT_EQ(index.Size(), count);
+
+    const double recall = Recall(index, queries, 100, k);
+    EXPECT_GT(recall, 0.8);
+
+    // Searching wider trades speed for recall
+    index.SetEfSearch(256);
+    const double widerRecall = Recall(index, queries, 100, k);
+    EXPECT_GE(widerRecall, recall);
+    EXPECT_GT(widerRecall, 0.97);
+
+    // Adding more later still works alongside the parallel build
+    const auto more = ClusteredEmbeddings(1, n_embd, 4);
+    const int id = index.Add(more.data());
+    EXPECT_EQ(index.Search(more.data(), 1)[0].id, id);
+}
+
+
+
+
+#endif
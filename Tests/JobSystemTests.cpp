@@ -0,0 +1,90 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_JOBSYSTEMTESTS_H
+#define GAME3_JOBSYSTEMTESTS_H
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+using namespace testing;
+
+class JobSystemTests : public testing::Test
+{
+};
+
+TEST_F(JobSystemTests, TestEveryChunkRunsOnceOnEachCall)
+{
+    JobSystem jobs(3);
+    EXPECT_EQ(jobs.GetThreadCount(), 4);
+
+    std::vector<std::atomic<int>> runs(1000);
+
+    for (int call = 0; call < 20; call++)
+    {
+        jobs.ParallelFor(static_cast<int>(runs.size()), [&](const int chunk) { runs[chunk]++; });
+    }
+
+    for (const auto &count : runs)
+    {
+        EXPECT_EQ(count.load(), 20);
+    }
+}
+
+TEST_F(JobSystemTests, TestIdleThreadsStealFromBusyOnes)
+{
+    JobSystem jobs(3);
+
+    // The first chunk (the caller's) can't finish until another thread has taken one of the caller's other chunks,
+    // which only happens by stealing. It gives up after a while rather than hanging if nothing does.
+    constexpr int chunks = 64;
+    const auto callersLastChunk = chunks / jobs.GetThreadCount() - 1;
+    std::atomic<std::thread::id> firstChunkThread {};
+    std::atomic<bool> stolen {false};
+
+    jobs.ParallelFor(chunks, [&](const int chunk)
+    {
+        if (chunk == 0)
+        {
+            firstChunkThread = std::this_thread::get_id();
+            const auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!stolen && std::chrono::steady_clock::now() < giveUp)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        else if (chunk <= callersLastChunk)
+        {
+            // Wait to see who took chunk 0, it is always taken first from the caller's queue
+            while (firstChunkThread.load() == std::thread::id {})
+            {
+                std::this_thread::yield();
+            }
+
+            if (std::this_thread::get_id() != firstChunkThread.load())
+            {
+                stolen = true;
+            }
+        }
+    });
+
+    EXPECT_TRUE(stolen);
+
+    // Without workers everything runs on the caller
+    JobSystem serial;
+    std::set<std::thread::id> threads;
+    serial.ParallelFor(8, [&](int) { threads.insert(std::this_thread::get_id()); });
+    EXPECT_EQ(threads, std::set { std::this_thread::get_id() });
+}
+
+
+
+
+#endif //GAME3_JOBSYSTEMTESTS_H
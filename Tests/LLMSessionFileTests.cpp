@@ -0,0 +1,76 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_LLMSESSIONFILETESTS_H
+#define GAME3_LLMSESSIONFILETESTS_H
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "LLMSessionFile.h"
+
+using namespace testing;
+
+class LLMSessionFileTests : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        directory = std::filesystem::temp_directory_path() / "game3_session_file_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    // A stand in session of size bytes, last used minutesAgo
+    std::string MakeSession(const std::string &name, const size_t size, const int minutesAgo) const
+    {
+        const auto path = (directory / name).string();
+        std::ofstream(path, std::ios::binary) << std::string(size, 'x');
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - std::chrono::minutes(minutesAgo));
+        return path;
+    }
+
+    std::filesystem::path directory;
+};
+
+TEST_F(LLMSessionFileTests, TestTrimDeletesTheLeastRecentlyUsedSessions)
+{
+    const auto oldest = MakeSession("a.session", 100, 30);
+    const auto older = MakeSession("b.session", 100, 20);
+    const auto newest = MakeSession("c.session", 100, 10);
+    const auto other = MakeSession("notes.txt", 1000, 40);
+
+    LLMSessionFile::Trim(directory.string(), 250);
+
+    // Only sessions count towards the size and are deleted
+    EXPECT_FALSE(std::filesystem::exists(oldest));
+    EXPECT_TRUE(std::filesystem::exists(older));
+    EXPECT_TRUE(std::filesystem::exists(newest));
+    EXPECT_TRUE(std::filesystem::exists(other));
+}
+
+TEST_F(LLMSessionFileTests, TestTrimKeepsTheSessionJustSaved)
+{
+    const auto saved = MakeSession("a.session", 500, 30);
+    const auto older = MakeSession("b.session", 100, 20);
+
+    // Even though it's too big on its own
+    LLMSessionFile::Trim(directory.string(), 250, saved);
+
+    EXPECT_TRUE(std::filesystem::exists(saved));
+    EXPECT_FALSE(std::filesystem::exists(older));
+}
+
+
+
+
+#endif //GAME3_LLMSESSIONFILETESTS_H
@@ -6,9 +6,19 @@
 #define GAME3_LLMTESTS_H
 
 #include <events/EventManager.h>
+#include <chrono>
+#include <filesystem>
+#include <thread>
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include "BatchedLLM.h"
 #include "EmbeddingLLM.h"
+#include "InferenceThreading.h"
+#include "LLMMetrics.h"
+#include "LLMModelRegistry.h"
+#include "LLMRequestQueue.h"
+#include "NpcDecisions.h"
+#include "SamplingSettings.h"
 #include "SimpleLLM.h"
 #include "StreamingLLM.h"
 #include <file/SettingsManager.h>
@@ -110,6 +120,135 @@ TEST_F(LlmTests, TestInferringModel)
 
 }
 
+TEST_F(LlmTests, TestInferReusesCachedPromptPrefix)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+
+    SimpleLLM llm;
+
+    std::string first;
+    std::string shared;
+    std::string repeated;
+    InferenceStats firstStats {};
+    InferenceStats sharedStats {};
+    InferenceStats repeatedStats {};
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        llm.Initialize(inferringLLMModelPath);
+
+        first = llm.Infer("What is the largest city in France?", 10);
+        firstStats = llm.GetLastStats();
+
+        // Shares a preamble with the first prompt, so only the new suffix should be evaluated
+        shared = llm.Infer("What is the largest city in Germany?", 10);
+        sharedStats = llm.GetLastStats();
+
+        // Identical to the first prompt, only the last prompt token is re-evaluated
+        repeated = llm.Infer("What is the largest city in France?", 10);
+        repeatedStats = llm.GetLastStats();
+    });
+
+    ASSERT_STREQ(first.c_str(), "\n\nAnswers: 1. Paris");
+    ASSERT_STREQ(repeated.c_str(), first.c_str());
+    ASSERT_FALSE(shared.empty());
+
+    ASSERT_GT(firstStats.promptTokens, 1);
+    ASSERT_LT(sharedStats.promptTokens, firstStats.promptTokens);
+    ASSERT_EQ(repeatedStats.promptTokens, 1);
+}
+
+TEST_F(LlmTests, TestSamplerIsResetBetweenPrompts)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+
+    // The test settings always pick the most likely token
+    ASSERT_EQ(SamplingSettings::Load().temp, 0.0f);
+
+    // A more talkative personality with a fixed seed
+    auto parameters = SamplingSettings::Load();
+    parameters.temp = 0.9f;
+    parameters.seed = 1234;
+
+    SimpleLLM llm;
+
+    std::string first;
+    std::string second;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        llm.Initialize(inferringLLMModelPath);
+        llm.SetSamplingParameters(parameters);
+
+        first = llm.Infer("Tell me about the dungeon.", 16);
+        second = llm.Infer("Tell me about the dungeon.", 16);
+    });
+
+    // The sampler is kept, but starts each prompt from the same state (including its random numbers)
+    ASSERT_FALSE(first.empty());
+    ASSERT_EQ(first, second);
+}
+
+TEST_F(LlmTests, TestInferStructuredDecidesADirection)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+
+    SimpleLLM llm;
+
+    std::optional<gamelib::Direction> direction;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        llm.Initialize(inferringLLMModelPath);
+
+        // There are walls above and below, so only left and right can be chosen
+        direction = llm.InferStructured("You are in a corridor that runs from east to west. Which way do you go? "
+                                        "Answer in JSON.", NpcDecisions::NextDirection({gamelib::Direction::Left, gamelib::Direction::Right}));
+    });
+
+    ASSERT_TRUE(direction.has_value());
+    ASSERT_TRUE(*direction == gamelib::Direction::Left || *direction == gamelib::Direction::Right);
+}
+
+TEST_F(LlmTests, TestInferRestoresSavedSession)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+    const auto sessionDirectory = (std::filesystem::temp_directory_path() / "game3_sessions").string();
+    std::filesystem::remove_all(sessionDirectory);
+
+    std::string evaluated;
+    std::string restored;
+    InferenceStats evaluatedStats {};
+    InferenceStats restoredStats {};
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        // Evaluates the prompt and saves it
+        SimpleLLM first;
+        first.Initialize(inferringLLMModelPath);
+        first.SetSessionDirectory(sessionDirectory);
+        evaluated = first.Infer("What is the largest city in France?", 10);
+        evaluatedStats = first.GetLastStats();
+    });
+
+    ASSERT_FALSE(std::filesystem::is_empty(sessionDirectory));
+
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        // As if it were the next run, the prompt comes from the saved session
+        SimpleLLM second;
+        second.Initialize(inferringLLMModelPath);
+        second.SetSessionDirectory(sessionDirectory);
+        restored = second.Infer("What is the largest city in France?", 10);
+        restoredStats = second.GetLastStats();
+    });
+
+    ASSERT_STREQ(evaluated.c_str(), "\n\nAnswers: 1. Paris");
+    ASSERT_EQ(restored, evaluated);
+
+    // Only the last prompt token is evaluated again after the rest is restored
+    ASSERT_GT(evaluatedStats.promptTokens, 1);
+    ASSERT_EQ(restoredStats.promptTokens, 1);
+
+    std::filesystem::remove_all(sessionDirectory);
+}
+
 TEST_F(LlmTests, TestEmbeddingModel)
 {
     // Load the path to the embedding model
@@ -175,6 +314,159 @@ TEST_F(LlmTests, TestEmbeddingModel)
     }
 }
 
+TEST_F(LlmTests, TestEmbeddingsAreCachedAndDeduplicated)
+{
+    const auto embeddingModelPath = gamelib::SettingsManager::Get()->GetString("llm", "EmbeddingModelPath");
+
+    EmbeddingLLM embeddingModel;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        embeddingModel.Initialize(embeddingModelPath);
+    });
+
+    const std::vector<std::string> texts = { "A dark room.", "A rusty key.", "A dark room." };
+
+    const auto first = embeddingModel.GetEmbeddings(texts);
+
+    ASSERT_EQ(first.rows, 3);
+    ASSERT_EQ(first.n_embd, embeddingModel.GetEmbeddingModelDimensions());
+    ASSERT_EQ(first.data.size(), 3u * first.n_embd);
+
+    // The repeated text is only embedded (and cached) once
+    EXPECT_EQ(embeddingModel.GetCache().Size(), 2u);
+    EXPECT_TRUE(std::equal(first.Row(0), first.Row(0) + first.n_embd, first.Row(2)));
+    EXPECT_FALSE(std::equal(first.Row(0), first.Row(0) + first.n_embd, first.Row(1)));
+
+    // Asking again comes straight from the cache and gives the same values
+    const auto second = embeddingModel.GetEmbeddings(texts);
+
+    EXPECT_EQ(embeddingModel.GetCache().Size(), 2u);
+    EXPECT_EQ(second.data, first.data);
+
+    // The model can still be used after that, and agrees with the cache
+    const auto single = embeddingModel.GetEmbedding("A rusty key.");
+
+    ASSERT_EQ(single.size(), static_cast<size_t>(first.n_embd));
+    EXPECT_TRUE(std::equal(single.begin(), single.end(), first.Row(1)));
+}
+
+TEST_F(LlmTests, TestEmbeddingsOfMixedLengthsKeepTheirOrder)
+{
+    const auto embeddingModelPath = gamelib::SettingsManager::Get()->GetString("llm", "EmbeddingModelPath");
+
+    EmbeddingLLM embeddingModel;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        embeddingModel.Initialize(embeddingModelPath);
+    });
+
+    // Far longer than a batch, so it has to be embedded in chunks
+    std::string longText;
+    for (int i = 0; i < 200; i++)
+    {
+        longText += "The corridor goes on and on. ";
+    }
+
+    const std::vector<std::string> texts = { "A dark room.", longText, "A rusty key lies on the floor by the door.", "Up." };
+
+    const auto packed = embeddingModel.GetEmbeddings(texts);
+
+    ASSERT_EQ(packed.rows, 4);
+
+    // Each row is what that text gets on its own
+    for (int row = 0; row < packed.rows; row++)
+    {
+        embeddingModel.GetCache().Clear();
+        const auto single = embeddingModel.GetEmbeddings({ texts[row] });
+
+        ASSERT_EQ(single.rows, 1);
+        for (int d = 0; d < packed.n_embd; d++)
+        {
+            EXPECT_NEAR(single.Row(0)[d], packed.Row(row)[d], 1e-3);
+        }
+    }
+
+    // The averaged chunks are normalised like any other embedding
+    double length = 0;
+    for (int d = 0; d < packed.n_embd; d++)
+    {
+        length += packed.Row(1)[d] * packed.Row(1)[d];
+    }
+    EXPECT_NEAR(length, 1.0, 1e-3);
+}
+
+TEST_F(LlmTests, TestLargeEmbeddingJobsAreTokenizedInWaves)
+{
+    const auto embeddingModelPath = gamelib::SettingsManager::Get()->GetString("llm", "EmbeddingModelPath");
+
+    EmbeddingLLM embeddingModel;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        embeddingModel.Initialize(embeddingModelPath);
+    });
+
+    // More than one wave, so later ones are tokenized while earlier ones are decoded
+    std::vector<std::string> texts;
+    for (int i = 0; i < 600; i++)
+    {
+        texts.push_back("Room " + std::to_string(i) + " has " + std::to_string(i % 7) + " doors.");
+    }
+
+    const auto all = embeddingModel.GetEmbeddings(texts);
+
+    ASSERT_EQ(all.rows, 600);
+    EXPECT_EQ(embeddingModel.GetCache().Size(), 600u);
+
+    // Rows from each wave are what the text gets on its own
+    for (const int row : { 0, 255, 256, 599 })
+    {
+        embeddingModel.GetCache().Clear();
+        const auto single = embeddingModel.GetEmbeddings({ texts[row] });
+
+        ASSERT_EQ(single.rows, 1);
+        for (int d = 0; d < all.n_embd; d++)
+        {
+            EXPECT_NEAR(single.Row(0)[d], all.Row(row)[d], 1e-3);
+        }
+    }
+}
+
+TEST_F(LlmTests, TestEmbeddingsWarmStartFromCacheFile)
+{
+    const auto cacheFilePath = gamelib::SettingsManager::Get()->GetString("llm", "EmbeddingCacheFilePath");
+    std::remove(cacheFilePath.c_str());
+
+    const std::vector<std::string> texts = { "A dark room.", "A rusty key." };
+    EmbeddingMatrix computed;
+
+    {
+        EmbeddingLLM embeddingModel;
+        StreamingLLM::RunWithoutStdErrOutput([&]()
+        {
+            embeddingModel.InitializeFromSettings();
+        });
+
+        computed = embeddingModel.GetEmbeddings(texts);
+        EXPECT_EQ(embeddingModel.GetCacheFile().Size(), 2u);
+    }
+
+    // A new run gets them from the file rather than the model
+    EmbeddingLLM embeddingModel;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        embeddingModel.InitializeFromSettings();
+    });
+
+    const auto loaded = embeddingModel.GetEmbeddings(texts);
+
+    EXPECT_EQ(embeddingModel.GetCache().Size(), 0u);
+    EXPECT_EQ(embeddingModel.GetCacheFile().Size(), 2u);
+    EXPECT_EQ(loaded.data, computed.data);
+
+    embeddingModel.GetCacheFile().Close();
+    std::remove(cacheFilePath.c_str());
+}
+
 TEST_F(LlmTests, TestStreamingLLM)
 {
     StreamingLLM streamingLLm;
@@ -220,6 +512,315 @@ TEST_F(LlmTests, TestStreamingLLM)
     ASSERT_EQ(1, countCompletionEvents);
 }
 
+TEST_F(LlmTests, TestSpeculativeDecodingMatchesGreedyDecoding)
+{
+    std::vector<std::string> tokens;
+    TestEventHandler testEventHandler([&](const std::shared_ptr<gamelib::Event> &evt)
+    {
+        if (evt->Id == LLMPredictedTokenReceivedEventEventId)
+        {
+            tokens.push_back(std::static_pointer_cast<LLMPredictedTokenReceivedEvent>(evt)->token);
+        }
+    });
+
+    testEventHandler.Init();
+
+    // The draft is the model itself made to guess badly: XTC throws away its most likely tokens, so most of its guesses
+    // are rejected and the answer has to come from the main model's checking alone
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+    common_params_sampling disagreeingDraft;
+    disagreeingDraft.top_k = 10;
+    disagreeingDraft.xtc_probability = 1.0f;
+    disagreeingDraft.xtc_threshold = 0.0001f;
+    disagreeingDraft.samplers = { COMMON_SAMPLER_TYPE_TOP_K, COMMON_SAMPLER_TYPE_XTC };
+
+    const auto generate = [&](const bool speculative)
+    {
+        tokens.clear();
+
+        StreamingLLM streamingLLm;
+        streamingLLm.SetSpeculativeDecoding(speculative);
+        if (speculative)
+        {
+            streamingLLm.SetDraftModel(inferringLLMModelPath, disagreeingDraft);
+        }
+        streamingLLm.Initialize("What is the largest city in England?", 32);
+
+        StreamingLLM::RunWithoutStdErrOutput([&]()
+        {
+            streamingLLm.Update(0);
+        });
+
+        gamelib::EventManager::Get()->ProcessAllEvents();
+
+        return tokens;
+    };
+
+    const auto &metrics = LLMMetrics::Get();
+    const auto greedy = generate(false);
+    const auto draftedBefore = metrics.draftedTokens.Get();
+    const auto acceptedBefore = metrics.acceptedDraftTokens.Get();
+    const auto speculative = generate(true);
+
+    ASSERT_FALSE(greedy.empty());
+    EXPECT_EQ(speculative, greedy);
+
+    // Drafting really was on, and the draft got some wrong
+    const auto drafted = metrics.draftedTokens.Get() - draftedBefore;
+    const auto accepted = metrics.acceptedDraftTokens.Get() - acceptedBefore;
+    EXPECT_GT(drafted, 0u);
+    EXPECT_LT(accepted, drafted);
+}
+
+TEST_F(LlmTests, TestStreamingLLMAsync)
+{
+    StreamingLLM streamingLLm(".", true);
+    streamingLLm.SetMaxTokensPerFrame(1);
+
+    int tokensReceived = 0;
+    int completionsReceived = 0;
+    TestEventHandler testEventHandler([&](const std::shared_ptr<gamelib::Event> &evt)
+    {
+        if (evt->Id == LLMPredictedTokenReceivedEventEventId) { tokensReceived++; }
+        if (evt->Id == LLMPredictionCompleteEventEventId) { completionsReceived++; }
+    });
+
+    testEventHandler.Init();
+
+    // Initialize hands the prompt off to the inference thread
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        streamingLLm.Initialize("What is the largest city in England?", 10);
+    });
+
+    // Let every token queue up first, so that it is the frame budget and not the model's speed that spreads them out
+    const auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (!streamingLLm.IsInferenceFinished() && std::chrono::steady_clock::now() < giveUp)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_TRUE(streamingLLm.IsInferenceFinished());
+
+    const auto eventManager = gamelib::EventManager::Get();
+
+    // Each frame raises exactly one token, the last frame raises the completion as well
+    auto frames = 0;
+    do
+    {
+        const auto tokensBefore = tokensReceived;
+
+        streamingLLm.Update(16);
+        eventManager->ProcessAllEvents();
+
+        ASSERT_EQ(tokensReceived - tokensBefore, 1);
+        frames++;
+    }
+    while (streamingLLm.IsGenerating());
+
+    ASSERT_EQ(11, tokensReceived);
+    ASSERT_EQ(1, completionsReceived);
+    ASSERT_EQ(11, frames);
+}
+
+
+TEST_F(LlmTests, TestInferenceThreadsKeepOffReservedCores)
+{
+    bool cpuMask[GGML_MAX_N_THREADS];
+
+    ASSERT_TRUE(InferenceThreading::MaskOutCores("0", cpuMask));
+    EXPECT_FALSE(cpuMask[0]);
+    EXPECT_EQ(cpuMask[1], std::thread::hardware_concurrency() > 1);
+
+    ASSERT_TRUE(InferenceThreading::MaskOutCores("0-1,3", cpuMask));
+    EXPECT_FALSE(cpuMask[1]);
+    EXPECT_FALSE(cpuMask[3]);
+
+    EXPECT_FALSE(InferenceThreading::MaskOutCores("first", cpuMask));
+    EXPECT_FALSE(InferenceThreading::MaskOutCores("2-1", cpuMask));
+
+    // Whatever a context asks for, it gets the policy's thread counts
+    InferenceThreading::Get()->LoadSettings();
+
+    auto contextParameters = llama_context_default_params();
+    contextParameters.n_threads = 16;
+    InferenceThreading::Get()->Apply(contextParameters);
+
+    EXPECT_EQ(contextParameters.n_threads, InferenceThreading::Get()->GetGenerationThreads());
+    EXPECT_EQ(contextParameters.n_threads_batch, InferenceThreading::Get()->GetPromptThreads());
+    EXPECT_GE(contextParameters.n_threads, 1);
+    EXPECT_LE(contextParameters.n_threads, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+}
+
+TEST_F(LlmTests, TestModelRegistrySharesModelsAndContexts)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+    const auto registry = LLMModelRegistry::Get();
+
+    auto modelParameters = llama_model_default_params();
+    modelParameters.n_gpu_layers = 99;
+
+    std::shared_ptr<llama_model> first;
+    std::shared_ptr<llama_model> second;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        first = registry->AcquireModel(inferringLLMModelPath, modelParameters);
+        second = registry->AcquireModel(inferringLLMModelPath, modelParameters);
+    });
+
+    // The same weights are only loaded once
+    ASSERT_NE(nullptr, first);
+    ASSERT_EQ(first.get(), second.get());
+
+    auto contextParameters = llama_context_default_params();
+    contextParameters.n_ctx = 128;
+
+    std::shared_ptr<llama_context> context;
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        context = registry->AcquireContext(first, contextParameters);
+    });
+    const auto firstContext = context.get();
+
+    // Hand it back to the pool and ask for a smaller one, we should get the same one back
+    context = nullptr;
+    contextParameters.n_ctx = 64;
+    context = registry->AcquireContext(first, contextParameters);
+
+    ASSERT_EQ(firstContext, context.get());
+}
+
+TEST_F(LlmTests, TestBatchedLLMGeneratesManySequencesTogether)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+
+    BatchedLLM llm;
+
+    std::map<int, std::string> streamed;
+    std::map<int, std::string> completed;
+
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        ASSERT_TRUE(llm.Initialize(inferringLLMModelPath, 4, 128));
+
+        // Submit the same question for every sequence, each NPC should get the same (greedy) answer
+        for (int i = 0; i < llm.GetMaxSequences(); i++)
+        {
+            const auto requestId = llm.Submit("What is the largest city in France?", 10,
+                [&](const int id, const std::string &token) { streamed[id] += token; },
+                [&](const int id, const std::string &response) { completed[id] = response; });
+
+            ASSERT_NE(-1, requestId);
+        }
+
+        // All the sequences are busy
+        ASSERT_FALSE(llm.HasFreeSequence());
+        ASSERT_EQ(-1, llm.Submit("Are there any free sequences?", 10));
+
+        llm.RunToCompletion();
+    });
+
+    ASSERT_EQ(4, completed.size());
+    for (const auto &[requestId, response] : completed)
+    {
+        ASSERT_FALSE(response.empty());
+        ASSERT_EQ(streamed[requestId], response);
+        ASSERT_EQ(completed.begin()->second, response);
+    }
+    ASSERT_TRUE(llm.HasFreeSequence());
+}
+
+TEST_F(LlmTests, TestBatchedLLMRequestsSubmittedOnCompletionStartCleanly)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+    const std::string question = "What is the largest city in France?";
+
+    BatchedLLM llm;
+    std::map<int, std::string> completed;
+    std::vector<int> followUps;
+
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        ASSERT_TRUE(llm.Initialize(inferringLLMModelPath, 3, 128));
+
+        const auto complete = [&](const int id, const std::string &response) { completed[id] = response; };
+
+        // The first request finishes after one token and submits two more, the second of which goes into the last
+        // sequence, after the one still generating
+        llm.Submit(question, 1, {}, [&](int, const std::string &)
+        {
+            followUps.push_back(llm.Submit(question, 10, {}, complete));
+            followUps.push_back(llm.Submit(question, 10, {}, complete));
+        });
+        const auto longest = llm.Submit(question, 10, {}, complete);
+
+        llm.RunToCompletion();
+
+        ASSERT_EQ(2u, followUps.size());
+        ASSERT_EQ(3u, completed.size());
+        ASSERT_FALSE(completed[longest].empty());
+
+        // Each is generated from its own prompt, not from another sequence's logits
+        for (const auto id : followUps)
+        {
+            ASSERT_EQ(completed[longest], completed[id]);
+        }
+    });
+}
+
+TEST_F(LlmTests, TestRequestQueueAdmitsIntoFreeSequencesAndDropsOverflow)
+{
+    const auto inferringLLMModelPath = gamelib::SettingsManager::Get()->GetString("llm", "InferringLLMModelPath");
+
+    const auto llm = std::make_shared<BatchedLLM>();
+
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        ASSERT_TRUE(llm->Initialize(inferringLLMModelPath, 2, 128));
+    });
+
+    // Two in flight at a time, three waiting at most
+    LLMRequestQueue requestQueue(llm, 2, 3, LLMQueueOverflowPolicy::DropLowestPriority);
+
+    std::vector<std::string> completedPrompts;
+    std::vector<std::string> droppedPrompts;
+
+    const auto makeRequest = [&](const std::string &prompt, const int priority)
+    {
+        LLMRequest request;
+        request.prompt = prompt;
+        request.n_predict = 5;
+        request.priority = priority;
+        request.onComplete = [&completedPrompts, prompt](const std::string &) { completedPrompts.push_back(prompt); };
+        request.onDropped = [&droppedPrompts, prompt]() { droppedPrompts.push_back(prompt); };
+        return request;
+    };
+
+    ASSERT_NE(-1, requestQueue.Enqueue(makeRequest("Low", 0)));
+    ASSERT_NE(-1, requestQueue.Enqueue(makeRequest("Medium", 1)));
+    ASSERT_NE(-1, requestQueue.Enqueue(makeRequest("High", 2)));
+
+    // The queue is full: the lowest priority request makes way for a higher one, but not for an even lower one
+    ASSERT_NE(-1, requestQueue.Enqueue(makeRequest("Urgent", 3)));
+    ASSERT_EQ(-1, requestQueue.Enqueue(makeRequest("Lowest", -1)));
+    ASSERT_EQ(3, requestQueue.CountQueued());
+    ASSERT_EQ((std::vector<std::string>{"Low", "Lowest"}), droppedPrompts);
+
+    StreamingLLM::RunWithoutStdErrOutput([&]()
+    {
+        // The two highest priority requests are admitted on the first update
+        requestQueue.Update();
+        ASSERT_EQ(2, requestQueue.CountInFlight());
+        ASSERT_EQ(1, requestQueue.CountQueued());
+
+        while (!requestQueue.IsIdle())
+        {
+            requestQueue.Update();
+        }
+    });
+
+    ASSERT_EQ(3, completedPrompts.size());
+    ASSERT_EQ("Medium", completedPrompts.back());
+}
 
 
 
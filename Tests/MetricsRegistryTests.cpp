@@ -0,0 +1,98 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_METRICSREGISTRYTESTS_H
+#define GAME3_METRICSREGISTRYTESTS_H
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "MetricsRegistry.h"
+
+using namespace testing;
+
+class MetricsRegistryTests : public testing::Test
+{
+};
+
+TEST_F(MetricsRegistryTests, TestMetricsAreSharedByName)
+{
+    auto &counter = MetricsRegistry::Get()->GetCounter("test.shared");
+    counter.Add();
+    MetricsRegistry::Get()->GetCounter("test.shared").Add(2);
+
+    EXPECT_EQ(counter.Get(), 3);
+    EXPECT_EQ(&counter, &MetricsRegistry::Get()->GetCounter("test.shared"));
+
+    MetricsRegistry::Get()->GetGauge("test.gauge").Set(12.5);
+
+    bool found = false;
+    for (const auto &[name, value] : MetricsRegistry::Get()->Snapshot())
+    {
+        if (name == "test.gauge")
+        {
+            EXPECT_EQ(value, 12.5);
+            found = true;
+        }
+    }
+    EXPECT_TRUE(found);
+}
+
+TEST_F(MetricsRegistryTests, TestHistogramPercentilesAreClose)
+{
+    Histogram histogram;
+
+    EXPECT_EQ(histogram.Percentile(0.5), 0);
+
+    // 1ms to 100ms, so the 50th percentile is 50ms and the 90th is 90ms
+    for (int ms = 1; ms <= 100; ms++)
+    {
+        histogram.Record(ms);
+    }
+
+    EXPECT_EQ(histogram.Count(), 100);
+    EXPECT_NEAR(histogram.Mean(), 50.5, 0.001);
+    EXPECT_EQ(histogram.Max(), 100);
+    EXPECT_NEAR(histogram.Percentile(0.5), 50, 50 * 0.1);
+    EXPECT_NEAR(histogram.Percentile(0.9), 90, 90 * 0.1);
+    EXPECT_LE(histogram.Percentile(1.0), 100);
+}
+
+TEST_F(MetricsRegistryTests, TestDumpWritesTabSeparatedRows)
+{
+    const auto path = (std::filesystem::temp_directory_path() / "game3_metrics_test.txt").string();
+
+    MetricsRegistry::Get()->GetCounter("test.dumped").Add(7);
+    MetricsRegistry::Get()->GetHistogram("test.dumped_ms").Record(2);
+
+    MetricsRegistry::Get()->StartDumping(path, 10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    MetricsRegistry::Get()->StopDumping();
+
+    std::ifstream file(path);
+    std::string header;
+    std::string row;
+    std::getline(file, header);
+    std::getline(file, row);
+
+    EXPECT_EQ(header.rfind("TimeSecs\t", 0), 0);
+    EXPECT_NE(header.find("\ttest.dumped\t"), std::string::npos);
+    EXPECT_NE(header.find("\ttest.dumped_ms.p99"), std::string::npos);
+
+    // Every row has a value for every column
+    EXPECT_EQ(std::count(header.begin(), header.end(), '\t'), std::count(row.begin(), row.end(), '\t'));
+
+    file.close();
+    std::filesystem::remove(path);
+}
+
+
+
+
+#endif
@@ -0,0 +1,135 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_MOVEPROBABILITYMATRIXTESTS_H
+#define GAME3_MOVEPROBABILITYMATRIXTESTS_H
+
+#include <gtest/gtest.h>
+#include <array>
+#include <vector>
+
+#include "MoveProbabilityMatrix.h"
+
+using namespace testing;
+
+class MoveProbabilityMatrixTests : public testing::Test
+{
+public:
+    static constexpr uint8_t up = 1 << static_cast<int>(gamelib::Direction::Up);
+    static constexpr uint8_t down = 1 << static_cast<int>(gamelib::Direction::Down);
+    static constexpr uint8_t left = 1 << static_cast<int>(gamelib::Direction::Left);
+    static constexpr uint8_t right = 1 << static_cast<int>(gamelib::Direction::Right);
+};
+
+TEST_F(MoveProbabilityMatrixTests, TestOpenDirectionsAreEquallyLikelyAndWallsNeverChosen)
+{
+    const MoveProbabilityMatrix matrix({ static_cast<uint8_t>(down | right), static_cast<uint8_t>(up | left | right), up });
+    NpcRandom random(1);
+
+    constexpr int samples = 30000;
+    std::array<std::array<int, 4>, 3> counts {};
+
+    for (int room = 0; room < 3; room++)
+    {
+        for (int i = 0; i < samples; i++)
+        {
+            counts[room][static_cast<int>(matrix.SelectAction(room, random))]++;
+        }
+    }
+
+    EXPECT_EQ(counts[0][0], 0);
+    EXPECT_EQ(counts[0][2], 0);
+    EXPECT_NEAR(counts[0][1], samples / 2, samples / 50);
+    EXPECT_NEAR(counts[0][3], samples / 2, samples / 50);
+
+    EXPECT_EQ(counts[1][1], 0);
+    for (const int direction : { 0, 2, 3 })
+    {
+        EXPECT_NEAR(counts[1][direction], samples / 3, samples / 50);
+    }
+
+    EXPECT_EQ(counts[2][0], samples);
+
+    EXPECT_TRUE(matrix.CanFromRoomInDirection(0, gamelib::Direction::Down));
+    EXPECT_FALSE(matrix.CanFromRoomInDirection(0, gamelib::Direction::Up));
+    EXPECT_FALSE(matrix.CanFromRoomInDirection(0, gamelib::Direction::Left));
+    EXPECT_TRUE(matrix.CanFromRoomInDirection(2, gamelib::Direction::Up));
+    EXPECT_FALSE(matrix.CanFromRoomInDirection(2, gamelib::Direction::Right));
+}
+
+TEST_F(MoveProbabilityMatrixTests, TestBatchSelectionMatchesOneAtATime)
+{
+    const MoveProbabilityMatrix matrix({ static_cast<uint8_t>(up | down | left | right), static_cast<uint8_t>(left | right), down });
+
+    constexpr int npcs = 100;
+    std::vector<int> rooms(npcs);
+    std::vector<NpcRandom> batchRandoms;
+    std::vector<NpcRandom> singleRandoms;
+    for (int i = 0; i < npcs; i++)
+    {
+        rooms[i] = i % 3;
+        batchRandoms.emplace_back(42, i);
+        singleRandoms.emplace_back(42, i);
+    }
+
+    std::vector<gamelib::Direction> directions(npcs);
+    matrix.SelectActions(rooms.data(), batchRandoms.data(), directions.data(), npcs);
+
+    for (int i = 0; i < npcs; i++)
+    {
+        EXPECT_EQ(directions[i], matrix.SelectAction(rooms[i], singleRandoms[i]));
+    }
+}
+
+TEST_F(MoveProbabilityMatrixTests, TestChangingWallsOnlyChangesThoseRooms)
+{
+    MoveProbabilityMatrix matrix({ right, left, static_cast<uint8_t>(up | down) });
+
+    // A wall goes up between rooms 0 and 1, so both rooms change
+    matrix.SetOpenDirections(0, 0);
+    matrix.SetOpenDirections(1, 0);
+
+    for (const auto direction : { gamelib::Direction::Up, gamelib::Direction::Down, gamelib::Direction::Left, gamelib::Direction::Right })
+    {
+        EXPECT_FALSE(matrix.CanFromRoomInDirection(0, direction));
+        EXPECT_FALSE(matrix.CanFromRoomInDirection(1, direction));
+    }
+
+    EXPECT_TRUE(matrix.CanFromRoomInDirection(2, gamelib::Direction::Up));
+    EXPECT_TRUE(matrix.CanFromRoomInDirection(2, gamelib::Direction::Down));
+    EXPECT_FALSE(matrix.CanFromRoomInDirection(2, gamelib::Direction::Left));
+
+    // A room that wasn't there when the matrix was made
+    matrix.SetOpenDirections(3, left);
+    NpcRandom random;
+    EXPECT_EQ(matrix.GetRoomCount(), 4);
+    EXPECT_EQ(matrix.SelectAction(3, random), gamelib::Direction::Left);
+}
+
+TEST_F(MoveProbabilityMatrixTests, TestEachNpcsRandomNumbersAreItsOwn)
+{
+    // The same seed on different streams gives different numbers, the same seed and stream the same ones
+    NpcRandom a(7, 1), b(7, 2), c(7, 1);
+
+    int same = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        const auto value = a.Next();
+        same += value == b.Next();
+        EXPECT_EQ(value, c.Next());
+
+        const auto unit = a.NextFloat();
+        EXPECT_GE(unit, 0.0f);
+        EXPECT_LT(unit, 1.0f);
+        b.Next();
+        c.Next();
+    }
+
+    EXPECT_LT(same, 3);
+}
+
+
+
+
+#endif
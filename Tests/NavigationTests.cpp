@@ -0,0 +1,109 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NAVIGATIONTESTS_H
+#define GAME3_NAVIGATIONTESTS_H
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "Navigation.h"
+
+using namespace testing;
+
+class NavigationTests : public testing::Test
+{
+public:
+    static constexpr uint8_t up = 1 << static_cast<int>(gamelib::Direction::Up);
+    static constexpr uint8_t down = 1 << static_cast<int>(gamelib::Direction::Down);
+    static constexpr uint8_t left = 1 << static_cast<int>(gamelib::Direction::Left);
+    static constexpr uint8_t right = 1 << static_cast<int>(gamelib::Direction::Right);
+
+    // A 3x3 maze with one way through it, snaking from the top left to the bottom right. Each room only opens
+    // towards the next one:
+    // 0 > 1 > 2
+    //         v
+    // 3 < 4 < 5
+    // v
+    // 6 > 7 > 8
+    static std::vector<uint8_t> Snake()
+    {
+        return { right, right, down, down, left, left, right, right, left };
+    }
+
+    static std::vector<uint8_t> Open()
+    {
+        return std::vector<uint8_t>(9, up | down | left | right);
+    }
+};
+
+TEST_F(NavigationTests, TestNeighboursComeFromWallsAndTheEdgeOfTheMaze)
+{
+    const RoomGraph graph(Snake(), 3);
+
+    EXPECT_EQ(graph.GetNeighbour(0, gamelib::Direction::Right), 1);
+    EXPECT_EQ(graph.GetNeighbour(0, gamelib::Direction::Down), RoomGraph::noRoom);
+    EXPECT_EQ(graph.GetNeighbour(2, gamelib::Direction::Down), 5);
+    EXPECT_EQ(graph.GetNeighbour(5, gamelib::Direction::Left), 4);
+    EXPECT_EQ(graph.GetNeighbour(3, gamelib::Direction::Down), 6);
+
+    // Open sides on the edge of the maze don't wrap round to the next row
+    const RoomGraph open(Open(), 3);
+    EXPECT_EQ(open.GetNeighbour(2, gamelib::Direction::Right), RoomGraph::noRoom);
+    EXPECT_EQ(open.GetNeighbour(3, gamelib::Direction::Left), RoomGraph::noRoom);
+    EXPECT_EQ(open.GetNeighbour(1, gamelib::Direction::Up), RoomGraph::noRoom);
+    EXPECT_EQ(open.GetNeighbour(7, gamelib::Direction::Down), RoomGraph::noRoom);
+}
+
+TEST_F(NavigationTests, TestFlowFieldFollowsTheOnlyWayThrough)
+{
+    const RoomGraph graph(Snake(), 3);
+    FlowField flowField(graph);
+    flowField.SetTarget(8);
+
+    EXPECT_EQ(flowField.GetDistance(0), 8);
+    EXPECT_EQ(flowField.GetDistance(8), 0);
+    EXPECT_EQ(flowField.GetNextDirection(8), gamelib::Direction::None);
+
+    // Following the field from the start ends at the target in as many moves as it says
+    int room = 0;
+    int moves = 0;
+    while (room != 8 && moves < 9)
+    {
+        room = graph.GetNeighbour(room, flowField.GetNextDirection(room));
+        moves++;
+    }
+    EXPECT_EQ(room, 8);
+    EXPECT_EQ(moves, 8);
+
+    // Room 0 opens towards room 1 but not the other way round, so there is no way back to the start
+    flowField.SetTarget(0);
+    EXPECT_EQ(flowField.GetDistance(1), FlowField::unreachable);
+    EXPECT_EQ(flowField.GetNextDirection(1), gamelib::Direction::None);
+}
+
+TEST_F(NavigationTests, TestFlowFieldsFollowTheTargetAndChangingWalls)
+{
+    // Only keep two fields, so the target moving around has to reuse them
+    Navigation navigation(RoomGraph(Open(), 3), 2);
+
+    EXPECT_EQ(navigation.GetFlowField(8).GetDistance(0), 4);
+    EXPECT_EQ(navigation.GetNextDirection(8, 6), gamelib::Direction::Left);
+    EXPECT_EQ(navigation.GetNextDirection(8, 2), gamelib::Direction::Up);
+    EXPECT_EQ(navigation.GetNextDirection(6, 8), gamelib::Direction::Right);
+    EXPECT_EQ(navigation.GetNextDirection(2, 0), gamelib::Direction::Left);
+    EXPECT_EQ(navigation.GetNextDirection(0, 0), gamelib::Direction::None);
+
+    // Wall room 1 in on every side but the bottom, so the way from there to room 0 goes round through room 4
+    navigation.SetOpenDirections(1, down);
+
+    EXPECT_EQ(navigation.GetFlowField(0).GetDistance(1), 3);
+    EXPECT_EQ(navigation.GetNextDirection(1, 0), gamelib::Direction::Down);
+    EXPECT_EQ(navigation.GetFlowField(0).GetDistance(2), 4);
+}
+
+
+
+
+#endif //GAME3_NAVIGATIONTESTS_H
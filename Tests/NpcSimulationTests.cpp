@@ -0,0 +1,146 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_NPCSIMULATIONTESTS_H
+#define GAME3_NPCSIMULATIONTESTS_H
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "NpcSimulation.h"
+
+using namespace testing;
+
+class NpcSimulationTests : public testing::Test
+{
+public:
+    static constexpr uint8_t up = 1 << static_cast<int>(gamelib::Direction::Up);
+    static constexpr uint8_t down = 1 << static_cast<int>(gamelib::Direction::Down);
+    static constexpr uint8_t left = 1 << static_cast<int>(gamelib::Direction::Left);
+    static constexpr uint8_t right = 1 << static_cast<int>(gamelib::Direction::Right);
+
+    // 3x3 rooms of 100x50 pixels with a 10 pixel margin
+    static constexpr RoomLayout layout { 10, 10, 100, 50, 3 };
+
+    static NpcSimulation Make(const std::vector<uint8_t> &openDirections)
+    {
+        return { std::make_shared<MoveProbabilityMatrix>(openDirections),
+                 std::make_shared<Navigation>(RoomGraph(openDirections, layout.columns)), layout };
+    }
+};
+
+TEST_F(NpcSimulationTests, TestNpcsWalkFromTheMiddleOfOneRoomToTheNext)
+{
+    // Room 4, in the middle, only opens to the right and room 5 only back to the left
+    std::vector<uint8_t> openDirections(9, 0);
+    openDirections[4] = right;
+    openDirections[5] = left;
+
+    auto simulation = Make(openDirections);
+    simulation.SetSpeed(100); // a room's width a second
+    simulation.Add(4, 1);
+
+    EXPECT_FLOAT_EQ(simulation.GetX()[0], 160);
+    EXPECT_FLOAT_EQ(simulation.GetY()[0], 85);
+
+    // Past the wall half way along, the NPC is in the next room
+    simulation.Update(400);
+    EXPECT_EQ(simulation.GetDirections()[0], gamelib::Direction::Right);
+    EXPECT_EQ(simulation.GetRooms()[0], 4);
+    simulation.Update(200);
+    EXPECT_EQ(simulation.GetRooms()[0], 5);
+
+    // It stops in the middle of the room rather than overshooting, then heads back
+    simulation.Update(1000);
+    EXPECT_FLOAT_EQ(simulation.GetX()[0], 260);
+    EXPECT_EQ(simulation.GetStates()[0], NpcSimulation::State::Waiting);
+
+    simulation.Update(100);
+    EXPECT_EQ(simulation.GetDirections()[0], gamelib::Direction::Left);
+    EXPECT_FLOAT_EQ(simulation.GetX()[0], 250);
+    EXPECT_FLOAT_EQ(simulation.GetY()[0], 85);
+}
+
+TEST_F(NpcSimulationTests, TestNpcsNeverWalkThroughWalls)
+{
+    // A room with no way out keeps its NPC, the others only move between rooms there is a way between
+    const std::vector<uint8_t> openDirections = {
+        static_cast<uint8_t>(down | right), static_cast<uint8_t>(left | right), static_cast<uint8_t>(left | down),
+        static_cast<uint8_t>(up | down), 0, static_cast<uint8_t>(up | down),
+        static_cast<uint8_t>(up | right), static_cast<uint8_t>(left | right), static_cast<uint8_t>(left | up)
+    };
+    const RoomGraph graph(openDirections, layout.columns);
+
+    auto simulation = Make(openDirections);
+    simulation.SetSpeed(1000);
+    simulation.SetPauseMs(5);
+    for (int npc = 0; npc < 100; npc++)
+    {
+        simulation.Add(npc % 9, npc);
+    }
+
+    auto previousRooms = simulation.GetRooms();
+    for (int frame = 0; frame < 2000; frame++)
+    {
+        simulation.Update(16);
+
+        for (int npc = 0; npc < simulation.GetCount(); npc++)
+        {
+            const int from = previousRooms[npc];
+            const int to = simulation.GetRooms()[npc];
+            if (from != to)
+            {
+                ASSERT_EQ(graph.GetNeighbour(from, simulation.GetDirections()[npc]), to);
+            }
+        }
+
+        previousRooms = simulation.GetRooms();
+    }
+
+    for (int npc = 0; npc < simulation.GetCount(); npc++)
+    {
+        EXPECT_EQ(simulation.GetRooms()[npc] == 4, npc % 9 == 4);
+    }
+}
+
+TEST_F(NpcSimulationTests, TestSharingNpcsAcrossThreadsGivesTheSameResult)
+{
+    std::vector<uint8_t> openDirections(9, up | down | left | right);
+    openDirections[4] = 0;
+
+    auto serial = Make(openDirections);
+    auto threaded = Make(openDirections);
+    JobSystem jobs(3);
+
+    // Enough NPCs for several chunks
+    for (int npc = 0; npc < 5000; npc++)
+    {
+        serial.Add(npc % 9, npc);
+        threaded.Add(npc % 9, npc);
+    }
+
+    for (int frame = 0; frame < 200; frame++)
+    {
+        serial.Update(16);
+        threaded.Update(16, &jobs);
+
+        ASSERT_EQ(serial.GetRoomChanges().size(), threaded.GetRoomChanges().size());
+        for (size_t change = 0; change < serial.GetRoomChanges().size(); change++)
+        {
+            ASSERT_EQ(serial.GetRoomChanges()[change].npc, threaded.GetRoomChanges()[change].npc);
+            ASSERT_EQ(serial.GetRoomChanges()[change].toRoom, threaded.GetRoomChanges()[change].toRoom);
+        }
+    }
+
+    EXPECT_EQ(serial.GetX(), threaded.GetX());
+    EXPECT_EQ(serial.GetY(), threaded.GetY());
+    EXPECT_EQ(serial.GetRooms(), threaded.GetRooms());
+}
+
+
+
+
+#endif //GAME3_NPCSIMULATIONTESTS_H
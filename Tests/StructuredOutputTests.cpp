@@ -0,0 +1,64 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_STRUCTUREDOUTPUTTESTS_H
+#define GAME3_STRUCTUREDOUTPUTTESTS_H
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "NpcDecisions.h"
+#include "StructuredOutput.h"
+
+using namespace testing;
+
+class StructuredOutputTests : public testing::Test
+{
+};
+
+TEST_F(StructuredOutputTests, TestGrammarOnlyAllowsTheGivenValues)
+{
+    JsonObjectGrammar object;
+    object.Enum("direction", {"Up", "Left"}).Integer("steps", 2);
+
+    const auto expected =
+        "root ::= \"{\" ws \"\\\"direction\\\"\" ws \":\" ws value-direction ws \",\" ws \"\\\"steps\\\"\" ws \":\" ws value-steps ws \"}\"\n"
+        "value-direction ::= \"\\\"Up\\\"\" | \"\\\"Left\\\"\"\n"
+        "value-steps ::= \"-\"? [0-9]{1,2}\n"
+        "ws ::= [ \\t\\n]?\n";
+
+    EXPECT_EQ(object.ToGbnf(), expected);
+}
+
+TEST_F(StructuredOutputTests, TestParseWaitsForTheWholeObject)
+{
+    JsonObjectGrammar object;
+    object.Enum("direction", {"Up", "Left"}).Integer("steps");
+
+    EXPECT_FALSE(object.Parse("{\"direction\": \"Up\""));
+    EXPECT_FALSE(object.Parse("{\"direction\": \"Up\", \"steps\": 12"));
+    EXPECT_FALSE(object.Parse("{\"direction\": \"Down\", \"steps\": 12}"));
+
+    const auto values = object.Parse("{\"direction\": \"Up\", \"steps\": 12}");
+    ASSERT_TRUE(values);
+    EXPECT_EQ(values->at("direction"), "Up");
+    EXPECT_EQ(values->at("steps"), "12");
+}
+
+TEST_F(StructuredOutputTests, TestNextDirectionParsesIntoADirection)
+{
+    const auto output = NpcDecisions::NextDirection({gamelib::Direction::Down, gamelib::Direction::Right});
+
+    EXPECT_NE(output.grammar.find("\"\\\"Right\\\"\""), std::string::npos);
+    EXPECT_EQ(output.grammar.find("Up"), std::string::npos);
+
+    EXPECT_EQ(output.parse(" {\"direction\":\"Right\"}"), gamelib::Direction::Right);
+    EXPECT_FALSE(output.parse("{\"direction\":\"Up\"}"));
+    EXPECT_FALSE(output.parse("{\"direction\":\"Rig"));
+}
+
+
+
+
+#endif
@@ -0,0 +1,125 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_TOKENSTREAMTESTS_H
+#define GAME3_TOKENSTREAMTESTS_H
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+#include "LLMPredictedTokenEventPool.h"
+#include "SpscQueue.h"
+#include "TokenStream.h"
+
+using namespace testing;
+
+class TokenStreamTests : public testing::Test
+{
+};
+
+TEST_F(TokenStreamTests, TestDecoderHoldsBackCharactersSplitOverTokens)
+{
+    TokenDecoder decoder;
+
+    EXPECT_EQ(decoder.Append("Caf"), "Caf");
+
+    // "é" is 0xC3 0xA9, split over two tokens
+    EXPECT_EQ(decoder.Append("\xC3"), "");
+    EXPECT_EQ(decoder.Append("\xA9 au"), "\xC3\xA9 au");
+
+    // "€" is 0xE2 0x82 0xAC, split over three tokens with text before it
+    EXPECT_EQ(decoder.Append(" lait \xE2"), " lait ");
+    EXPECT_EQ(decoder.Append("\x82"), "");
+    EXPECT_EQ(decoder.Append("\xAC"), "\xE2\x82\xAC");
+
+    // A 4 byte character whose first three bytes come together
+    EXPECT_EQ(decoder.Append("\xF0\x9F\x98"), "");
+    EXPECT_EQ(decoder.Append("\x80!"), "\xF0\x9F\x98\x80!");
+
+    // Anything unfinished at the end can be flushed
+    EXPECT_EQ(decoder.Append("\xE2\x82"), "");
+    EXPECT_EQ(decoder.Flush(), "\xE2\x82");
+    EXPECT_EQ(decoder.Append("ok"), "ok");
+}
+
+TEST_F(TokenStreamTests, TestQueuePassesTokensBetweenThreadsInOrder)
+{
+    // Big enough that the character ring wraps around a number of times
+    constexpr int count = 100000;
+    TokenTextQueue queue;
+
+    std::thread producer([&]()
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const auto text = std::to_string(i);
+            while (!queue.Push(text))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::array<char, TokenTextQueue::maxTokenLength> buffer {};
+    std::string_view token;
+    for (int expected = 0; expected < count; )
+    {
+        if (queue.Pop(buffer, token))
+        {
+            ASSERT_EQ(token, std::to_string(expected));
+            expected++;
+        }
+    }
+
+    producer.join();
+
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_FALSE(queue.Pop(buffer, token));
+}
+
+TEST_F(TokenStreamTests, TestSpscQueueRefusesToOverfill)
+{
+    SpscQueue<int, 4> queue;
+
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(queue.TryPush(i));
+    }
+    EXPECT_FALSE(queue.TryPush(4));
+    EXPECT_EQ(queue.Size(), 4u);
+
+    int value;
+    EXPECT_TRUE(queue.TryPop(value));
+    EXPECT_EQ(value, 0);
+    EXPECT_TRUE(queue.TryPush(4));
+}
+
+TEST_F(TokenStreamTests, TestEventPoolReusesEventsOnceReleased)
+{
+    LLMPredictedTokenEventPool pool(2);
+
+    auto first = pool.Acquire("Hello");
+    auto second = pool.Acquire(" world");
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first->token, "Hello");
+
+    // Once the event has been handled it goes back into the pool
+    const auto* firstAddress = first.get();
+    first.reset();
+
+    const auto third = pool.Acquire("!");
+    EXPECT_EQ(third.get(), firstAddress);
+    EXPECT_EQ(third->token, "!");
+    EXPECT_EQ(pool.Size(), 2u);
+
+    // Grows only when everything is in use
+    const auto fourth = pool.Acquire("?");
+    EXPECT_EQ(pool.Size(), 3u);
+}
+
+
+
+
+#endif
@@ -0,0 +1,161 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "TokenStream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    // Number of bytes in the UTF-8 character that starts with this byte (1 for continuation or invalid bytes)
+    size_t Utf8SequenceLength(const unsigned char lead)
+    {
+        if ((lead & 0xE0) == 0xC0) return 2;
+        if ((lead & 0xF0) == 0xE0) return 3;
+        if ((lead & 0xF8) == 0xF0) return 4;
+        return 1;
+    }
+
+    // How many bytes at the end of the text belong to a character that isn't finished yet
+    size_t IncompleteTailLength(const char* text, const size_t length)
+    {
+        // A character is at most 4 bytes, so its lead byte is within the last 3
+        for (size_t back = 1; back <= std::min<size_t>(3, length); back++)
+        {
+            const auto byte = static_cast<unsigned char>(text[length - back]);
+
+            if ((byte & 0xC0) == 0x80) continue; // continuation byte, keep looking for the lead
+
+            return Utf8SequenceLength(byte) > back ? back : 0;
+        }
+
+        return 0;
+    }
+}
+
+bool TokenizeText(const llama_vocab* vocab, const std::string_view text, std::vector<llama_token> &tokens, const bool addSpecial,
+                  const bool parseSpecial)
+{
+    const auto tokenize = [&]
+    {
+        return llama_tokenize(vocab, text.data(), static_cast<int32_t>(text.size()), tokens.data(), static_cast<int32_t>(tokens.size()),
+                              addSpecial, parseSpecial);
+    };
+
+    // Room for a token per byte and the BOS/EOS that adding special tokens can add
+    tokens.resize(text.size() + 2);
+    auto n_tokens = tokenize();
+
+    if (n_tokens < 0 && n_tokens != std::numeric_limits<int32_t>::min())
+    {
+        tokens.resize(-n_tokens);
+        n_tokens = tokenize();
+    }
+
+    if (n_tokens < 0)
+    {
+        tokens.clear();
+        return false;
+    }
+
+    tokens.resize(n_tokens);
+    return true;
+}
+
+std::string_view TokenDecoder::Decode(const llama_token token)
+{
+    char piece[128];
+    const int n = llama_token_to_piece(vocab, token, piece, sizeof(piece), 0, true);
+
+    if (n < 0)
+    {
+        fprintf(stderr, "%s: error: failed to convert token to piece\n", __func__);
+        return {};
+    }
+
+    return Append({piece, static_cast<size_t>(n)});
+}
+
+std::string_view TokenDecoder::Append(const std::string_view piece)
+{
+    // The held back bytes, then as much of the piece as fits (pieces are far shorter than this in practice)
+    std::memcpy(output.data(), pending.data(), pendingLength);
+    const size_t pieceLength = std::min(piece.size(), output.size() - pendingLength);
+    std::memcpy(output.data() + pendingLength, piece.data(), pieceLength);
+
+    const size_t length = pendingLength + pieceLength;
+    const size_t incomplete = IncompleteTailLength(output.data(), length);
+
+    // Keep the unfinished character until the rest of it arrives
+    std::memcpy(pending.data(), output.data() + length - incomplete, incomplete);
+    pendingLength = incomplete;
+
+    return {output.data(), length - incomplete};
+}
+
+std::string_view TokenDecoder::Flush()
+{
+    std::memcpy(output.data(), pending.data(), pendingLength);
+    const std::string_view text(output.data(), pendingLength);
+    pendingLength = 0;
+    return text;
+}
+
+bool TokenTextQueue::Push(const std::string_view text)
+{
+    const size_t length = std::min(text.size(), maxTokenLength);
+
+    if (writePosition + length - readPosition.load(std::memory_order_acquire) > textCapacity)
+    {
+        return false;
+    }
+
+    // Copy in, wrapping around the end of the ring if need be
+    const size_t start = writePosition & (textCapacity - 1);
+    const size_t firstPart = std::min(length, textCapacity - start);
+    std::memcpy(characters.data() + start, text.data(), firstPart);
+    std::memcpy(characters.data(), text.data() + firstPart, length - firstPart);
+
+    // Publishing the length makes the characters visible to the consumer
+    if (!lengths.TryPush(static_cast<uint16_t>(length)))
+    {
+        return false;
+    }
+
+    writePosition += length;
+    return true;
+}
+
+bool TokenTextQueue::Pop(std::array<char, maxTokenLength> &out, std::string_view &text)
+{
+    uint16_t length;
+
+    if (!lengths.TryPop(length))
+    {
+        text = {};
+        return false;
+    }
+
+    const size_t read = readPosition.load(std::memory_order_relaxed);
+    const size_t start = read & (textCapacity - 1);
+    const size_t firstPart = std::min<size_t>(length, textCapacity - start);
+    std::memcpy(out.data(), characters.data() + start, firstPart);
+    std::memcpy(out.data() + firstPart, characters.data(), length - firstPart);
+
+    // The producer can reuse that space now
+    readPosition.store(read + length, std::memory_order_release);
+
+    text = {out.data(), length};
+    return true;
+}
+
+void TokenTextQueue::Clear()
+{
+    lengths.Clear();
+    writePosition = 0;
+    readPosition.store(0, std::memory_order_relaxed);
+}
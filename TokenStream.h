@@ -0,0 +1,90 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_TOKENSTREAM_H
+#define GAME3_TOKENSTREAM_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "llama.h"
+#include "SpscQueue.h"
+
+/**
+ * Tokenizes the text in one pass rather than asking llama_tokenize for the size first, reusing the vector's capacity.
+ * A token is nearly always at least a byte, so the text's length is enough room; if not, it is tokenized again.
+ * @return false (and no tokens) if the text could not be tokenized
+ */
+bool TokenizeText(const llama_vocab* vocab, std::string_view text, std::vector<llama_token> &tokens, bool addSpecial = true,
+                  bool parseSpecial = true);
+
+/**
+ * Turns predicted tokens into text without allocating. A character that is more than one byte in UTF-8 can be split
+ * over several tokens, so the bytes of an unfinished character are held back until the token that completes it
+ * arrives. The text it returns is therefore always whole characters.
+ */
+class TokenDecoder
+{
+public:
+    explicit TokenDecoder(const llama_vocab* vocab = nullptr) : vocab(vocab) {}
+
+    void SetVocab(const llama_vocab* vocab) { this->vocab = vocab; }
+
+    /**
+     * @return the text of the token (plus any bytes held back from earlier tokens), which may be empty if the token
+     * only started a character. The view is valid until the next call.
+     */
+    std::string_view Decode(llama_token token);
+
+    // As Decode, for a piece of text that has already been detokenized
+    std::string_view Append(std::string_view piece);
+
+    // Returns whatever is held back (e.g. at the end of generation) and forgets it
+    std::string_view Flush();
+
+    void Reset() { pendingLength = 0; }
+
+private:
+    const llama_vocab* vocab;
+    std::array<char, 4> pending {}; // bytes of an unfinished character
+    size_t pendingLength = 0;
+    std::array<char, 260> output {}; // the held back bytes then the latest piece
+};
+
+/**
+ * Hands token text from the inference thread to the game thread without locks or allocation: the text goes into a
+ * preallocated ring of characters and each token's length into an SpscQueue. Push from one thread, Pop from one other.
+ */
+class TokenTextQueue
+{
+public:
+    static constexpr size_t maxTokenLength = 256;
+
+    // Producer only. Returns false if there isn't room, the consumer needs to catch up.
+    bool Push(std::string_view text);
+
+    /**
+     * Consumer only. Copies the oldest token's text into out.
+     * @return the token's text (a view of out) or an empty view with false if there are no tokens waiting
+     */
+    bool Pop(std::array<char, maxTokenLength> &out, std::string_view &text);
+
+    [[nodiscard]] bool Empty() const { return lengths.Empty(); }
+
+    // Only safe when neither thread is using the queue
+    void Clear();
+
+private:
+    static constexpr size_t textCapacity = 1 << 16;
+
+    std::array<char, textCapacity> characters {};
+    SpscQueue<uint16_t, 4096> lengths;
+    size_t writePosition = 0;                  // producer's own, published by pushing a length
+    alignas(64) std::atomic<size_t> readPosition {0}; // advanced by the consumer once it has copied a token out
+};
+
+#endif //GAME3_TOKENSTREAM_H
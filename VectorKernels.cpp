@@ -0,0 +1,207 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#include "VectorKernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define GAME3_VECTOR_AVX2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GAME3_VECTOR_NEON
+#endif
+
+#ifdef GAME3_VECTOR_AVX2
+static float HorizontalSum(const __m256 v)
+{
+    const __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    const __m128 sum2 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    const __m128 sum1 = _mm_add_ss(sum2, _mm_movehdup_ps(sum2));
+    return _mm_cvtss_f32(sum1);
+}
+#endif
+
+float DotF32(const float* a, const float* b, const int n)
+{
+    int i = 0;
+    float sum = 0.0f;
+
+#if defined(GAME3_VECTOR_AVX2)
+    // Two accumulators to hide the latency of the fma
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    sum = HorizontalSum(_mm256_add_ps(acc0, acc1));
+#elif defined(GAME3_VECTOR_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+
+    // Whatever is left over (or everything, without SIMD)
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+
+    return sum;
+}
+
+float DotF32I8(const float* a, const int8_t* b, const int n)
+{
+    int i = 0;
+    float sum = 0.0f;
+
+#if defined(GAME3_VECTOR_AVX2)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        // Widen 8 int8s to 8 floats
+        const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i));
+        const __m256 bf = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+        acc = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), bf, acc);
+    }
+    sum = HorizontalSum(acc);
+#elif defined(GAME3_VECTOR_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8)
+    {
+        // Widen 8 int8s to two lots of 4 floats
+        const int16x8_t wide = vmovl_s8(vld1_s8(b + i));
+        const float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide)));
+        const float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(wide)));
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), lo);
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), hi);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+
+    for (; i < n; i++)
+    {
+        sum += a[i] * static_cast<float>(b[i]);
+    }
+
+    return sum;
+}
+
+int32_t DotI8(const int8_t* a, const int8_t* b, const int n)
+{
+    int i = 0;
+    int32_t sum = 0;
+
+#if defined(GAME3_VECTOR_AVX2)
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16)
+    {
+        // Widen 16 int8s to int16, then multiply and add neighbouring pairs into int32s
+        const __m256i a16 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        const __m256i b16 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a16, b16));
+    }
+    __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = _mm_cvtsi128_si32(sum4);
+#elif defined(GAME3_VECTOR_NEON)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; i + 16 <= n; i += 16)
+    {
+        // Products of int8s in [-127, 127] fit in int16, pairs of them are added into int32s
+        const int8x16_t va = vld1q_s8(a + i);
+        const int8x16_t vb = vld1q_s8(b + i);
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc = vpadalq_s16(acc, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+    }
+    sum = vaddvq_s32(acc);
+#endif
+
+    for (; i < n; i++)
+    {
+        sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+    }
+
+    return sum;
+}
+
+int HammingDistance(const uint64_t* a, const uint64_t* b, const int words)
+{
+    // A popcnt per word, the 384 dimensions of bge-small are only 6 words
+    int distance = 0;
+    for (int i = 0; i < words; i++)
+    {
+        distance += std::popcount(a[i] ^ b[i]);
+    }
+
+    return distance;
+}
+
+float QuantiseInt8(const float* values, int8_t* out, const int n)
+{
+    float maxAbs = 0.0f;
+    for (int i = 0; i < n; i++)
+    {
+        maxAbs = std::max(maxAbs, std::fabs(values[i]));
+    }
+
+    const float scale = maxAbs / 127.0f;
+    const float inverse = scale > 0.0f ? 1.0f / scale : 0.0f;
+
+    for (int i = 0; i < n; i++)
+    {
+        out[i] = static_cast<int8_t>(std::clamp(std::lround(values[i] * inverse), -127L, 127L));
+    }
+
+    return scale;
+}
+
+float QuantiseBinary(const float* values, uint64_t* out, const int n)
+{
+    std::fill_n(out, (n + 63) / 64, 0);
+
+    float sumAbs = 0.0f;
+    for (int i = 0; i < n; i++)
+    {
+        sumAbs += std::fabs(values[i]);
+
+        if (values[i] > 0.0f)
+        {
+            out[i / 64] |= uint64_t {1} << (i % 64);
+        }
+    }
+
+    return n > 0 ? sumAbs / static_cast<float>(n) : 0.0f;
+}
+
+const char* GetVectorKernelName()
+{
+#if defined(GAME3_VECTOR_AVX2)
+    return "AVX2";
+#elif defined(GAME3_VECTOR_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
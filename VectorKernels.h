@@ -0,0 +1,41 @@
+//
+// Created by stuart on 18/10/2026.
+//
+
+#ifndef GAME3_VECTORKERNELS_H
+#define GAME3_VECTORKERNELS_H
+
+#include <cstdint>
+
+// Dot products used for similarity search. These use AVX2/FMA or NEON when the build targets them and fall back to
+// plain loops otherwise, the results agree to within float rounding.
+
+// Dot product of two float vectors of length n
+float DotF32(const float* a, const float* b, int n);
+
+// Dot product of a float vector and an int8 vector of length n (the int8 values are not scaled)
+float DotF32I8(const float* a, const int8_t* b, int n);
+
+// Dot product of two int8 vectors of length n (neither is scaled)
+int32_t DotI8(const int8_t* a, const int8_t* b, int n);
+
+// Number of bits that differ between two bit vectors of the given number of 64 bit words
+int HammingDistance(const uint64_t* a, const uint64_t* b, int words);
+
+/**
+ * Quantises the vector to int8 with a single symmetric scale, so that value[i] ~= out[i] * scale.
+ * @return the scale
+ */
+float QuantiseInt8(const float* values, int8_t* out, int n);
+
+/**
+ * Keeps just the sign of each value, one bit each (set for positive) in (n + 63) / 64 words, so that
+ * value[i] ~= (bit i ? 1 : -1) * scale.
+ * @return the scale, the mean absolute value
+ */
+float QuantiseBinary(const float* values, uint64_t* out, int n);
+
+// Name of the kernels that were compiled in, e.g. "AVX2"
+const char* GetVectorKernelName();
+
+#endif //GAME3_VECTORKERNELS_H
@@ -26,6 +26,8 @@
 #include <mazer/EnemyMovedEvent.h>
 
 #include "EmbeddingLLM.h"
+#include "JobSystem.h"
+#include "MetricsRegistry.h"
 #include "SimpleLLM.h"
 #include "StreamingLLM.h"
 
@@ -210,6 +212,9 @@ int main(int, char* [])
 			}
 		}
 
+		// Write the inference metrics out every so often if asked to ("metrics"/"DumpFilePath")
+		MetricsRegistry::Get()->LoadSettings();
+
 		// Initialize the game structure
 		GameStructure infrastructure(CreateGameLoopStrategy());
 
@@ -230,6 +235,12 @@ int main(int, char* [])
 
 		auto isUnloaded = infrastructure.Unload();
 
+		// Writes the last row of metrics
+		MetricsRegistry::Get()->StopDumping();
+
+		// Finishes the NPC crowd's worker threads, if there was a crowd
+		JobSystem::Get()->Stop();
+
 		return IsSuccess(isUnloaded, "Unloading game subsystems successful.");
 	}
 	catch (const EngineException& e)